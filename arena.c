@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./arena.h"
+
+// bytes requested from malloc for each chunk of small objects
+#define CHUNK_SIZE (1 << 20)
+#define MAX_SMALL_SIZE (ARENA_CLASSES * ARENA_ALIGN)
+
+// chunks are linked so that they can be released together
+// data is padded to keep objects aligned
+struct ZArenaChunk {
+  struct ZArenaChunk *next;
+  char pad[ARENA_ALIGN - sizeof(struct ZArenaChunk *)];
+  char data[];
+};
+
+// large objects are doubly linked so that a single one can be freed early
+struct ZArenaLarge {
+  struct ZArenaLarge *prev;
+  struct ZArenaLarge *next;
+  char data[];
+};
+
+// helper functions
+static void *amalloc(size_t size);
+
+struct ZArena *zcreate_arena(void)
+{
+  struct ZArena *arena;
+
+  arena = amalloc(sizeof(struct ZArena));
+  memset(arena, 0, sizeof(struct ZArena));
+
+  return arena;
+}
+
+void zfree_arena(struct ZArena *arena)
+{
+  struct ZArenaChunk *chunk;
+  struct ZArenaLarge *large;
+
+  while ((chunk = arena->chunks)) {
+    arena->chunks = chunk->next;
+    free(chunk);
+  }
+
+  while ((large = arena->large)) {
+    arena->large = large->next;
+    free(large);
+  }
+
+  free(arena);
+}
+
+void *zarena_alloc(struct ZArena *arena, size_t size)
+{
+  struct ZArenaChunk *chunk;
+  struct ZArenaLarge *large;
+  size_t class;
+  void *ptr;
+
+  if (!arena) return amalloc(size);
+
+  if (size > MAX_SMALL_SIZE) {
+    large = amalloc(sizeof(struct ZArenaLarge) + size);
+    large->prev = NULL;
+    large->next = arena->large;
+    if (arena->large) arena->large->prev = large;
+    arena->large = large;
+    return large->data;
+  }
+
+  class = size ? (size - 1) / ARENA_ALIGN : 0;
+
+  // reuse a freed object of the same class
+  if ((ptr = arena->free_lists[class])) {
+    arena->free_lists[class] = *(void **)ptr;
+    return ptr;
+  }
+
+  size = (class + 1) * ARENA_ALIGN;
+
+  // the tail of a full chunk is abandoned, it is smaller than one large object
+  if (arena->end - arena->next < (ptrdiff_t)size) {
+    chunk = amalloc(sizeof(struct ZArenaChunk) + CHUNK_SIZE);
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->next = chunk->data;
+    arena->end = chunk->data + CHUNK_SIZE;
+  }
+
+  ptr = arena->next;
+  arena->next += size;
+
+  return ptr;
+}
+
+void *zarena_calloc(struct ZArena *arena, size_t size)
+{
+  void *ptr;
+
+  ptr = zarena_alloc(arena, size);
+  memset(ptr, 0, size);
+
+  return ptr;
+}
+
+void zarena_free(struct ZArena *arena, void *ptr, size_t size)
+{
+  struct ZArenaLarge *large;
+  size_t class;
+
+  if (!arena) {
+    free(ptr);
+    return;
+  }
+
+  if (size > MAX_SMALL_SIZE) {
+    large = (struct ZArenaLarge *)((char *)ptr - offsetof(struct ZArenaLarge, data));
+    if (large->prev) large->prev->next = large->next;
+    else arena->large = large->next;
+    if (large->next) large->next->prev = large->prev;
+    free(large);
+    return;
+  }
+
+  // freed object holds the link to the next free object of its class
+  class = size ? (size - 1) / ARENA_ALIGN : 0;
+  *(void **)ptr = arena->free_lists[class];
+  arena->free_lists[class] = ptr;
+}
+
+static void *amalloc(size_t size)
+{
+  void *ptr;
+
+  ptr = malloc(size);
+
+  if (!ptr) exit(EXIT_FAILURE);
+
+  return ptr;
+}
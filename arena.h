@@ -0,0 +1,37 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// arena allocator for small objects that share a lifetime
+// sizes are rounded up to size classes carved out of large chunks
+// freed objects are kept on a free list of their size class for reuse
+// larger objects fall back to malloc but are still released with the arena
+// an arena must only be used by one thread at a time
+
+#define ARENA_ALIGN 16
+#define ARENA_CLASSES 64 // classes of ARENA_ALIGN bytes, larger objects use malloc
+
+struct ZArenaChunk;
+struct ZArenaLarge;
+
+// struct representing an arena
+struct ZArena {
+  struct ZArenaChunk *chunks;
+  struct ZArenaLarge *large;
+  char *next;
+  char *end;
+  void *free_lists[ARENA_CLASSES];
+};
+
+// arena creation and destruction, freeing an arena releases every object allocated from it
+struct ZArena *zcreate_arena(void);
+void zfree_arena(struct ZArena *arena);
+
+// allocation, size must be the same when allocating and freeing an object
+// a NULL arena allocates with malloc and frees with free
+void *zarena_alloc(struct ZArena *arena, size_t size);
+void *zarena_calloc(struct ZArena *arena, size_t size);
+void zarena_free(struct ZArena *arena, void *ptr, size_t size);
+
+#endif
@@ -0,0 +1,85 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "binfile.h"
+
+static void bin_failure(const char* message) {
+    perror(message);
+    exit(EXIT_FAILURE);
+}
+
+bin_files* create_bin_files(const char* dir, int count, size_t record_size) {
+    bin_files* bins = malloc(sizeof(bin_files));
+    char* path = malloc(strlen(dir) + sizeof("/binning-XXXXXX"));
+    int fd;
+
+    bins->count = count;
+    bins->record_size = record_size;
+    bins->files = calloc(count, sizeof(FILE*));
+
+    for (int i = 0; i < count; i++) {
+        sprintf(path, "%s/binning-XXXXXX", dir);
+        if ((fd = mkstemp(path)) < 0) {
+            free(path);
+            free_bin_files(bins);
+            return NULL;
+        }
+        unlink(path);
+        if ((bins->files[i] = fdopen(fd, "w+b")) == NULL) {
+            close(fd);
+            free(path);
+            free_bin_files(bins);
+            return NULL;
+        }
+    }
+
+    free(path);
+    return bins;
+}
+
+void free_bin_files(bin_files* bins) {
+    for (int i = 0; i < bins->count; i++) {
+        close_bin(bins, i);
+    }
+
+    free(bins->files);
+    free(bins);
+}
+
+// appends record to the end of bin, buffered by stdio
+void write_bin_record(bin_files* bins, int bin, const void* record) {
+    if (fwrite(record, bins->record_size, 1, bins->files[bin]) != 1) {
+        bin_failure("could not write bin file");
+    }
+}
+
+// starts reading bin from its first record, to be called once all records are written
+void rewind_bin(bin_files* bins, int bin) {
+    if (fflush(bins->files[bin]) != 0) {
+        bin_failure("could not write bin file");
+    }
+    rewind(bins->files[bin]);
+}
+
+// reads up to max_records of bin in the order they were written
+// returns number of records read, 0 once the bin is exhausted
+size_t read_bin_records(bin_files* bins, int bin, void* records, size_t max_records) {
+    size_t count = fread(records, bins->record_size, max_records, bins->files[bin]);
+
+    if (count < max_records && ferror(bins->files[bin])) {
+        bin_failure("could not read bin file");
+    }
+
+    return count;
+}
+
+// closes file of bin which releases its disk space
+void close_bin(bin_files* bins, int bin) {
+    if (bins->files[bin] != NULL) {
+        fclose(bins->files[bin]);
+        bins->files[bin] = NULL;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef BINFILE_H
+#define BINFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// set of temporary files on disk, each holding fixed size records appended to one bin
+// files are unlinked as soon as they are created so they disappear when closed or on exit
+// a bin must only be written by one thread at a time
+typedef struct bin_files {
+    int count;              // number of bins
+    size_t record_size;     // bytes of each record
+    FILE** files;
+} bin_files;
+
+// bin files creation and destruction
+// returns NULL if the files cannot be created in dir
+bin_files* create_bin_files(const char* dir, int count, size_t record_size);
+void free_bin_files(bin_files* bins);
+
+// bin operations
+void write_bin_record(bin_files* bins, int bin, const void* record);
+void rewind_bin(bin_files* bins, int bin);
+size_t read_bin_records(bin_files* bins, int bin, void* records, size_t max_records);
+void close_bin(bin_files* bins, int bin);
+
+#endif
@@ -3,18 +3,36 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include "zhash.h"
-#include "llist.h"
-
-#define MMER_SIZE 4        // efficient to keep mmer_size as powers of 2
-#define KMER_SIZE 31       // fixed size of initial kmer extracted from reads
-#define ABUNDANCE_CUTOFF 1 // kmer should occur in more reads than cutoff to avoid deletion
-#define READ_LENGTH 101    // maximum size of read supported
-
-// defined constants for faster multiplication
-// MMER_SIZE should not exceed length of power_val
-const int power_val[] = {1, 4, 16, 64, 256, 1024, 4096, 16384};
+#include "fhash.h"
+#include "idlist.h"
+#include "readfile.h"
+#include "encode.h"
+#include "sketch.h"
+#include "binfile.h"
+#include "comm.h"
+#include "snapshot.h"
+
+#define MAX_KMER_SIZE 64   // kmers are packed two bits per base pair into FHASH_MAX_KEY_WORDS words
+#define MAX_MMER_SIZE 15   // packed mmers double as int scores
+#define DIRECT_MMER_SIZE 10 // mmer tables have a slot for every mmer up to this size instead of hashing them
+#define BATCH_READS 4096   // reads parsed together by worker threads during parallel ingestion
+#define ENCODE_CHUNK 1024  // base pairs of a read encoded together
+#define BIN_FILES 64       // kmers binned on disk are split over at least this many files by mmer
+#define BIN_CHUNK 4096     // kmer records read from a bin file at a time
+#define SUPERKMER_WORDS 4  // words of base pairs in a super-kmer, longer runs of kmers are split
+
+// parameters set from the command line
+int kmer_size = 31;        // size of initial kmer extracted from reads
+int mmer_size = 4;         // efficient to keep mmer_size as powers of 2
+int abundance_cutoff = 1;  // kmer should occur in more reads than cutoff to avoid deletion
+bool random_order = false; // signatures follow a random order of mmers instead of dictionary order
+bool super_kmers = false;  // kmers are passed between threads, ranks and bin files as super-kmers
+bool sort_counting = false; // kmers of each bin are counted by sorting them instead of storing them one at a time
 
 // possible sizes for hash table
 static const size_t hash_sizes[] = {
@@ -22,18 +40,86 @@ static const size_t hash_sizes[] = {
     104729, 250007, 500009, 1000003, 2000029, 4000037, 10000019,
     25000009, 50000047, 104395301, 217645177, 512927357, 1000000007};
 
+// counts of all kmers from a first pass over the reads, kmers it estimates at no more than
+// abundance_cutoff are not stored as they would be pruned anyway
+// NULL when there is no first pass and while it is running
+static struct CSketch *kmer_sketch = NULL;
+
+// files kmers are written to during ingestion instead of being stored, bin of a kmer is mmer % count
+// each bin is loaded and pruned on its own afterwards, NULL when kmers are stored directly
+static bin_files *kmer_bins = NULL;
+
+// snapshot the kmer tables were loaded from instead of reads, read id lists of kmers point into it
+// until expand_read_id_list copies them, NULL when reads were ingested
+static snapshot *kmer_snapshot = NULL;
+
+// kmers and unitigs by their first and last kmer_size - 1 base pairs packed, values are entry_end lists
+// maintained by extension as it inserts and deletes entries, NULL before extension
+static struct FHashTable *entry_heads = NULL, *entry_tails = NULL;
+
+// arena for keys, entries and read ids of kmers and unitigs from unpacking till the end of extension
+// NULL before unpacking when ingestion and pruning allocate with malloc
+static struct ZArena *extension_arena = NULL;
+
 typedef struct kmer_extension_node
 {
     struct ZHashEntry **extend_entry;
     struct ZHashTable *extend_table;
 } kmer_extension_node;
 
+// unitig being grown by extension
+// key is null terminated and lies inside buffer with room to grow at both ends
 typedef struct more_kmer_extension_node
 {
     char *key;
-    ll_node *read_id_lists;
+    int key_len;
+    char *buffer;
+    int capacity;
+    read_id_spans *read_ids;
 } more_kmer_extension_node;
 
+// packed kmer parsed from a read along with the mmer signature it is stored under
+typedef struct kmer_record
+{
+    uint64_t kmer[FHASH_MAX_KEY_WORDS];
+    int mmer;
+    int read_id;
+} kmer_record;
+
+// run of consecutive kmers of a read sharing a signature, a super-kmer
+// base pairs are packed like a kmer, the last one in the low bits of the first word
+// the kmers are the kmer_size windows of the kmer_size + kmers - 1 base pairs
+typedef struct superkmer_record
+{
+    uint64_t bases[SUPERKMER_WORDS];
+    int mmer;
+    int read_id;
+    int kmers;
+} superkmer_record;
+
+// receives every kmer parsed from a read
+typedef void (*kmer_sink)(void *sink_data, int mmer, const uint64_t *kmer, int read_id);
+
+// parses all kmers of a read, see extract_kmers
+typedef void (*kmer_extractor)(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data);
+
+// entry with a given end in the entry end index, one of the entries with that end
+typedef struct entry_end
+{
+    struct ZHashEntry *entry;
+    struct ZHashTable *table;
+    int mmer_score;
+    struct entry_end *next;
+} entry_end;
+
+// entry overlapping a kmer end and the mmer bucket it is stored in
+typedef struct extension_candidate
+{
+    struct ZHashEntry *entry;
+    struct ZHashTable *table;
+    int mmer_score;
+} extension_candidate;
+
 /*******************************************
  * Helper Macros
 *******************************************/
@@ -68,46 +154,15 @@ typedef struct more_kmer_extension_node
 // converts numeric value of bp to its ascii value
 char getbp(int bp)
 {
-    switch (bp)
-    {
-    case 0:
-        return 'T';
-
-    case 1:
-        return 'G';
-
-    case 2:
-        return 'C';
-
-    case 3:
-        return 'A';
-
-    default:
-        return 'A';
-    }
+    return bp >= 0 && bp < 4 ? "TGCA"[bp] : 'A';
 }
 
 // converts ascii character to its numeric value
+// characters that are not base pairs count as 'A'
 int getval(char c)
 {
-    switch (c)
-    {
-    case 'T':
-        return 0;
-
-    case 'G':
-        return 1;
-        
-    case 'C':
-        return 2;
-
-    case 'A':
-        return 3;
-
-    default:
-        return 3;
-        
-    }
+    int code = base_codes[(unsigned char)c];
+    return code == BASE_INVALID ? 3 : code;
 }
 
 // calculates numeric score of "string" by summing numeric scores of all characters in the string
@@ -123,121 +178,207 @@ int getscore(char *string)
     return score;
 }
 
-// returns score of next smaller mmer in dictionary order
-// converts passed "mmer" string to next smaller mmer representation in dictionary order
-// wraps around from AAAA to TTTT
-int next_smaller_mmer(char *mmer, int mmer_score)
+// packs first len characters of string two bits per base pair using their numeric values
+// identical to the score of the string so packed mmers double as their score
+uint64_t pack_kmer(char *string, int len)
 {
-    for (int i = MMER_SIZE - 1; i >= 0; i--)
+    uint64_t packed = 0;
+    for (int i = 0; i < len; i++)
     {
-        if (mmer[i] == 'A')
-        {
-            mmer[i] = 'T';
-        }
-        else
-        {
-            mmer[i] = getbp(getval(mmer[i]) + 1);
-            break;
-        }
+        packed = (packed << 2) | getval(string[i]);
     }
 
-    return ++mmer_score;
+    return packed;
 }
 
-/*****************************************
- * Functions for merging read id lists, keys and strings and kmers
-*****************************************/
-
-// return new list of read id lists where continuous range of KMER_SIZE - 1 nodes of a_node and b_node are merged
-// forward direction merges right end of a_node with left end of b_node
-// backward direction merges right end of b_node with left end of a_node
-ll_node *merge_lists(int a_len, int b_len, ll_node *a_node, ll_node *b_node, bool forward)
+// converts packed kmer of len base pairs back to ascii in string
+// string must have space for len + 1 characters
+void unpack_kmer(uint64_t packed, int len, char *string)
 {
-    // swap for merging in backward direction
-    if (!forward)
+    string[len] = '\0';
+    for (int i = len - 1; i >= 0; i--)
     {
-        SWAP(a_node, b_node);
-        SWAP(a_len, b_len);
+        string[i] = getbp(packed & 3);
+        packed >>= 2;
     }
+}
 
-    // new_list points to starting list
-    ll_node *new_list = a_node;
-    int len = a_len;
+// returns number of words needed to pack len base pairs
+int packed_words(int len)
+{
+    return (len + 31) / 32;
+}
 
-    // skip read id lists that don't overlap
-    for (int i = 0; i < len - (KMER_SIZE - 1); i++)
+// packs first len characters of string like pack_kmer into as many words as needed
+// words hold the last 32 base pairs first, len may be up to MAX_KMER_SIZE
+void pack_kmer_words(char *string, int len, uint64_t *words)
+{
+    memset(words, 0, FHASH_MAX_KEY_WORDS * sizeof(uint64_t));
+    for (int i = 0; i < len; i++)
     {
-        a_node = a_node->next;
+        int shift = len - 1 - i;
+        words[shift / 32] |= (uint64_t)getval(string[i]) << 2 * (shift % 32);
     }
+}
 
-    // merge read id lists of two kmers for KMER_SIZE - 1 nodes that overlap
-    // nodes of b_node are freed as their values are transfered to a_node nodes
-    for (int i = 0; i < KMER_SIZE - 1; i++)
+// converts kmer packed by pack_kmer_words back to ascii in string
+void unpack_kmer_words(const uint64_t *words, int len, char *string)
+{
+    string[len] = '\0';
+    for (int i = 0; i < len; i++)
     {
-        a_node->item = merge_sorted_list(a_node->item, b_node->item);
-
-        ll_node *temp = b_node;
-        b_node = b_node->next;
-        free(temp);
+        int shift = len - 1 - i;
+        string[i] = getbp((words[shift / 32] >> 2 * (shift % 32)) & 3);
+    }
+}
 
-        if (i == KMER_SIZE - 2)
+// stores in scores the score of the mmer formed by extending key with each base pair
+// forward direction appends base pair to the last mmer_size - 1 base pairs of key
+// backward direction prepends base pair to the first mmer_size - 1 base pairs of key
+void extension_mmer_scores(char *key, int key_len, bool forward, int scores[4])
+{
+    if (forward)
+    {
+        int prefix = pack_kmer(&key[key_len - (mmer_size - 1)], mmer_size - 1) * 4;
+        for (int bp = 0; bp < 4; bp++)
         {
-            // after merging overlapping nodes link rest of b_node nodes to new list
-            a_node->next = b_node;
+            scores[bp] = prefix + bp;
         }
-        else
+    }
+    else
+    {
+        int suffix = pack_kmer(key, mmer_size - 1);
+        for (int bp = 0; bp < 4; bp++)
         {
-            a_node = a_node->next;
+            scores[bp] = (bp << 2 * (mmer_size - 1)) + suffix;
         }
     }
+}
+
+// returns rank of a canonical mmer, the signature of a kmer is its mmer with the highest rank
+// in dictionary order the rank is the score, which favours mmers rich in A and piles kmers into few tables
+// random order mixes the score with an invertible hash of its 2 * mmer_size bits so ranks stay distinct
+static inline int mmer_rank(int mmer)
+{
+    if (!random_order)
+    {
+        return mmer;
+    }
+
+    const uint64_t mask = (1ULL << 2 * mmer_size) - 1;
+    uint64_t rank = (mmer * 0x9e3779b97f4a7c15ULL) & mask;
+    rank ^= rank >> mmer_size;
+    rank = (rank * 0xc2b2ae3d27d4eb4fULL) & mask;
+    rank ^= rank >> mmer_size;
+    return rank;
+}
+
+static int compare_mmer_ranks(const void *a, const void *b)
+{
+    int a_rank = mmer_rank(*(const int *)a), b_rank = mmer_rank(*(const int *)b);
+    return (a_rank > b_rank) - (a_rank < b_rank);
+}
+
+// returns mmers of hash_table in increasing order of rank, which extension visits them in
+// count is set to the number of mmers, the array must be freed
+int *ordered_mmers(struct ZHashTable *hash_table, int *count)
+{
+    struct ZHashIterator iterator;
+    struct ZHashEntry **mmer_entry;
+    int *mmers = malloc(hash_table->entry_count * sizeof(int));
+
+    *count = 0;
+    zhash_iterate_init(&iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&iterator)) != NULL)
+    {
+        mmers[(*count)++] = (*mmer_entry)->packed_key;
+    }
+
+    qsort(mmers, *count, sizeof(int), compare_mmer_ranks);
+    return mmers;
+}
+
+/*****************************************
+ * Functions for merging read id lists, keys and strings and kmers
+*****************************************/
+
+// returns read ids of a and b which overlap at continuous kmer_size - 1 base pairs
+// forward direction merges right end of a with left end of b
+// backward direction merges right end of b with left end of a
+// ids of the overlap are not merged until the unitig's read ids are materialized
+read_id_spans *merge_read_ids(int a_len, int b_len, read_id_spans *a, read_id_spans *b, bool forward)
+{
+    if (forward)
+    {
+        return join_read_id_spans(a, b, a_len - (kmer_size - 1), extension_arena);
+    }
 
-    return new_list;
+    return join_read_id_spans(b, a, b_len - (kmer_size - 1), extension_arena);
 }
 
-// returns of true if a_string and b_string overlap at continuous KMER_SIZE - 1 base pairs
-// forward direction compares right end of a_string with left end of b_string
-// backward direction compares right end of b_string with left end of a_string
-bool compare_overlap(char *a_string, char *b_string, bool forward)
+// returns read id runs of each base pair of entry, which must be freed with free_unitig_read_ids
+read_id_run *unitig_read_ids(struct ZHashEntry *entry)
 {
-    // swap variables a_string and b_string when comparing backwards overlap
-    if (!forward)
+    return materialize_read_id_spans(entry->val, entry->key_len, extension_arena);
+}
+
+void free_unitig_read_ids(read_id_run *run)
+{
+    while (run != NULL)
     {
-        SWAP(a_string, b_string);
+        read_id_run *next = run->next;
+        free_read_id_run(run, extension_arena);
+        run = next;
     }
+}
 
-    int len = strlen(a_string);
-    for (int i = 0; i < KMER_SIZE - 1; i++)
+// makes room in the key buffer of node for before base pairs in front of the key and after base pairs behind it
+// buffer doubles when it is full so growing a unitig one kmer at a time copies each base pair a constant number of times
+void reserve_key(more_kmer_extension_node *node, int before, int after)
+{
+    // key of a new node still belongs to the entry it was copied from and has no buffer
+    if (node->buffer != NULL)
     {
-        if (a_string[len - (KMER_SIZE - 1) + i] != b_string[i])
+        int start = node->key - node->buffer;
+        if (start >= before && node->capacity - (start + node->key_len + 1) >= after)
         {
-            return false;
+            return;
         }
     }
 
-    return true;
+    // key is placed in the middle so that either end can grow
+    int needed = node->key_len + before + after + 1;
+    int capacity = MAX(2 * node->capacity, 2 * needed);
+    char *buffer = zarena_alloc(extension_arena, capacity * sizeof(char));
+    char *key = &buffer[before + (capacity - needed) / 2];
+    memcpy(key, node->key, node->key_len + 1);
+
+    if (node->buffer != NULL)
+    {
+        zarena_free(extension_arena, node->buffer, node->capacity * sizeof(char));
+    }
+    node->buffer = buffer;
+    node->capacity = capacity;
+    node->key = key;
 }
 
-// returns merged key of a_key and b_key which overlap at continuous KMER_SIZE - 1 base pairs
-// forward direction merges right end of a_key with left end of b_key
-// backward direction merges right end of b_key with left end of a_key
-char *merge_keys(int a_len, int b_len, char *a_key, char *b_key, bool forward)
+// adds the base pairs of b_key that do not overlap the key of node at kmer_size - 1 base pairs
+// forward direction appends them to the right end of the key and backward direction prepends them
+void merge_key(more_kmer_extension_node *node, char *b_key, int b_len, bool forward)
 {
-    int len = a_len + b_len + 1 - (KMER_SIZE - 1);
-    // Note: critical to use calloc, malloc can give unitialized string which can cause error
-    char *new_key = calloc(len, sizeof(char));
-
+    int added = b_len - (kmer_size - 1);
     if (forward)
     {
-        strncpy(new_key, a_key, a_len);
-        strncpy(&new_key[a_len], &b_key[KMER_SIZE - 1], b_len - (KMER_SIZE - 1));
+        reserve_key(node, 0, added);
+        memcpy(&node->key[node->key_len], &b_key[kmer_size - 1], added + 1);
     }
     else
     {
-        strncpy(new_key, b_key, b_len);
-        strncpy(&new_key[b_len], &a_key[KMER_SIZE - 1], a_len - (KMER_SIZE - 1));
+        reserve_key(node, added, 0);
+        node->key -= added;
+        memcpy(node->key, b_key, added);
     }
-
-    return new_key;
+    node->key_len += added;
 }
 
 // extends to kmer entries pointed to by given hash entries in given direction
@@ -245,406 +386,270 @@ char *merge_keys(int a_len, int b_len, char *a_key, char *b_key, bool forward)
 // Note: does not free given a and b hash table entries
 more_kmer_extension_node extend_kmers(struct ZHashEntry *a, struct ZHashEntry *b, bool forward)
 {
-    int a_len = strlen(a->key);
-    int b_len = strlen(b->key);
+    more_kmer_extension_node to_return;
 
     // merge read ids of both entries and concatenate keys
-    ll_node *new_read_ids = merge_lists(a_len, b_len, (ll_node *)a->val, (ll_node *)b->val, forward);
-    char *new_key = merge_keys(a_len, b_len, (char *)a->key, (char *)b->key, forward);
-    more_kmer_extension_node to_return;
-    to_return.key = new_key;
-    to_return.read_id_lists = new_read_ids;
+    to_return.read_ids = merge_read_ids(a->key_len, b->key_len, (read_id_spans *)a->val, (read_id_spans *)b->val, forward);
+    to_return.key = a->key;
+    to_return.key_len = a->key_len;
+    to_return.buffer = NULL;
+    to_return.capacity = 0;
+    merge_key(&to_return, b->key, b->key_len, forward);
     return to_return;
 }
 
 // takes partially extended kmer and extends with kmer in hash entry b
 // returns node containing pointer to merged kmer and read id list
-// Note: manages de-allocation of memory for previous key
+// Note: key grows in place, free buffer of the final node with free_extension_key
 more_kmer_extension_node further_extend_kmers(more_kmer_extension_node a, struct ZHashEntry *b, bool forward)
 {
-    int a_len = strlen(a.key);
-    int b_len = strlen(b->key);
-
     // merge read ids of both entries and concatenate keys
-    ll_node *new_read_ids = merge_lists(a_len, b_len, (ll_node *)a.read_id_lists, (ll_node *)b->val, forward);
-    char *new_key = merge_keys(a_len, b_len, (char *)a.key, (char *)b->key, forward);
-
-    free(a.key);
-    a.key = new_key;
-    a.read_id_lists = new_read_ids;
+    a.read_ids = merge_read_ids(a.key_len, b->key_len, a.read_ids, (read_id_spans *)b->val, forward);
+    merge_key(&a, b->key, b->key_len, forward);
     return a;
 }
 
-/*****************************************
- * Functions for easy and efficient iteration of records from hash table
- * Maintains static pointers to for efficiency and supports in place deletion
- * Note: level one and level two functions two support nested iteration
-*****************************************/
-
-/**
- * Usage: 
- * 1. Iteration: returns entries in hash_table one by one and NULL when no other entries left
- * hash_table: pass the same pointer while iterating it
- * indirection: false returns a pointer to the entry, true returns a pointer to the pointer of the entry
- * indirection is useful when modifying entries
- * remove_current: don't care
- * if deletion was called previously current entry is removed and next entry is returned
- * 2. Deletion: marks current entry for removal which is removed when next iteration in called
- * hash_table: pass NULL
- * indirection: don't care
- * remove_current: true
- * Note: be careful with deletion when performing nested iteration on the same hash_table
- */
-void *iterate_level_one_hash(struct ZHashTable *hash_table, bool indirection, bool remove_current)
+// releases key buffer of a unitig once it has been stored
+void free_extension_key(more_kmer_extension_node *node)
 {
-    static struct ZHashTable *table = NULL;
-    static struct ZHashEntry **entry;
-    static int index;
-    static bool remove;
+    zarena_free(extension_arena, node->buffer, node->capacity * sizeof(char));
+}
 
-    // remove currently pointed node
-    // when the next iterate is called
-    if (hash_table == NULL && remove_current)
+// packs kmer_size - 1 base pairs at the right end of key if right is true and the left end otherwise
+void pack_key_end(char *key, int key_len, bool right, uint64_t *end)
+{
+    if (right)
     {
-        remove = remove_current;
-        return NULL;
+        pack_kmer_words(&key[key_len - (kmer_size - 1)], kmer_size - 1, end);
+        return;
     }
 
-    // reset variables table does not match hash_table
-    if (table != hash_table)
-    {
-        table = hash_table;
-        entry = NULL;
-        index = 0;
-    }
+    pack_kmer_words(key, kmer_size - 1, end);
+}
+
+/*****************************************
+ * Index of entry ends
+ * An entry overlaps the end of a key at kmer_size - 1 base pairs exactly when its own opposite end
+ * is the same kmer_size - 1 base pairs, so every kmer and unitig is indexed by both of its ends
+*****************************************/
+
+// creates empty indexes
+void create_end_index(void)
+{
+    entry_heads = fcreate_hash_table(packed_words(kmer_size - 1));
+    entry_tails = fcreate_hash_table(packed_words(kmer_size - 1));
+}
+
+void free_end_index(void)
+{
+    // nodes are released along with extension_arena
+    ffree_hash_table(entry_heads);
+    ffree_hash_table(entry_tails);
+    entry_heads = entry_tails = NULL;
+}
 
-    // entry points to previously returned value in the same chain
-    // move to next entry in the chain
-    if (entry != NULL && *entry != NULL)
+// adds entry of table under end in index unless it is there already
+void index_entry_end(struct FHashTable *index, const uint64_t *end, struct ZHashTable *table, int mmer_score, struct ZHashEntry *entry)
+{
+    entry_end *ends = fhash_get(index, end);
+    for (entry_end *node = ends; node != NULL; node = node->next)
     {
-        if (!remove)
-        {
-            entry = &(*entry)->next;
-        }
-        else
+        if (node->entry == entry)
         {
-            // if current node is marked for removal handle differently
-            struct ZHashEntry *temp = *entry;
-            *entry = (*entry)->next;
-            zfree_entry(temp, false);
-            table->entry_count--;
-            remove = false;
+            return;
         }
     }
 
-    // entry points to empty chain
-    // move to next chain non empty chain
-    if (entry == NULL || *entry == NULL)
+    entry_end *node = zarena_alloc(extension_arena, sizeof(entry_end));
+    node->entry = entry;
+    node->table = table;
+    node->mmer_score = mmer_score;
+    node->next = ends;
+    fhash_set(index, end, node);
+}
+
+// removes entry from under end in index
+void unindex_entry_end(struct FHashTable *index, const uint64_t *end, struct ZHashEntry *entry)
+{
+    entry_end *ends = fhash_get(index, end), **node = &ends;
+    while (*node != NULL && (*node)->entry != entry)
     {
-        while (index < hash_sizes[table->size_index])
-        {
-            if (table->entries[index] != NULL)
-            {
-                entry = &table->entries[index];
-                index++;
-                break;
-            }
-            index++;
-        }
+        node = &(*node)->next;
     }
-
-    // if iteration has ended keep returning NULL for subsequent calls
-    if (entry == NULL || *entry == NULL)
+    if (*node == NULL)
     {
-        table = NULL;
-        return NULL;
+        return;
     }
 
-    if (indirection)
+    entry_end *removed = *node;
+    *node = removed->next;
+    zarena_free(extension_arena, removed, sizeof(entry_end));
+
+    if (ends == NULL)
     {
-        return entry;
+        fhash_delete(index, end);
     }
     else
     {
-        return *entry;
+        fhash_set(index, end, ends);
     }
 }
 
-/**
- * Usage: useful for nested iteration like iterating the hash_table for an mmer
- * 1. Iteration: returns entries in hash_table one by one and NULL when no other entries left
- * hash_table: pass the same pointer while iterating it
- * indirection: false returns a pointer to the entry, true returns a pointer to the pointer of the entry
- * indirection is useful when modifying entries
- * remove_current: don't care
- * if deletion was called previously current entry is removed and next entry is returned
- * 2. Deletion: marks current entry for removal which is removed when next iteration in called
- * hash_table: pass NULL
- * indirection: don't care
- * remove_current: true
- * Note: be careful with deletion when performing nested iteration on the same hash_table
- */
-void *iterate_level_two_hash(struct ZHashTable *hash_table, bool indirection, bool remove_current)
+// indexes entry of the table of mmer_score by its first and last kmer_size - 1 base pairs
+// to be called for every entry inserted during extension
+void index_entry(struct ZHashTable *table, int mmer_score, struct ZHashEntry *entry)
 {
-    static struct ZHashTable *table = NULL;
-    static struct ZHashEntry **entry;
-    static int index;
-    static bool remove;
-
-    // remove currently pointed node
-    // when the next iterate is called
-    if (hash_table == NULL && remove_current)
-    {
-        remove = remove_current;
-        return NULL;
-    }
+    uint64_t end[FHASH_MAX_KEY_WORDS];
+    pack_key_end(entry->key, entry->key_len, false, end);
+    index_entry_end(entry_heads, end, table, mmer_score, entry);
+    pack_key_end(entry->key, entry->key_len, true, end);
+    index_entry_end(entry_tails, end, table, mmer_score, entry);
+}
 
-    // reset variables table does not match hash_table
-    if (table != hash_table)
-    {
-        table = hash_table;
-        entry = NULL;
-        index = 0;
-    }
+// removes entry from the indexes, to be called for every entry deleted during extension before it is freed
+void unindex_entry(struct ZHashEntry *entry)
+{
+    uint64_t end[FHASH_MAX_KEY_WORDS];
+    pack_key_end(entry->key, entry->key_len, false, end);
+    unindex_entry_end(entry_heads, end, entry);
+    pack_key_end(entry->key, entry->key_len, true, end);
+    unindex_entry_end(entry_tails, end, entry);
+}
 
-    // entry points to previously returned value in the same chain
-    // move to next entry in the chain
-    if (entry != NULL && *entry != NULL)
-    {
-        if (!remove)
-        {
-            entry = &(*entry)->next;
-        }
-        else
-        {
-            // if current node is marked for removal handle differently
-            struct ZHashEntry *temp = *entry;
-            *entry = (*entry)->next;
-            zfree_entry(temp, false);
-            table->entry_count--;
-            remove = false;
-        }
-    }
+// indexes all entries of all mmer tables, to be called once before extension
+void index_entries(struct ZHashTable *hash_table)
+{
+    struct ZHashIterator mmer_iterator, kmer_iterator;
+    struct ZHashEntry **mmer_entry, **kmer_entry;
 
-    // entry points to empty chain
-    // move to next chain non empty chain
-    if (entry == NULL || *entry == NULL)
+    zhash_iterate_init(&mmer_iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
     {
-        while (index < hash_sizes[table->size_index])
+        zhash_iterate_init(&kmer_iterator, (*mmer_entry)->val);
+        while ((kmer_entry = zhash_iterate(&kmer_iterator)) != NULL)
         {
-            if (table->entries[index] != NULL)
-            {
-                entry = &table->entries[index];
-                index++;
-                break;
-            }
-            index++;
+            index_entry((*mmer_entry)->val, (*mmer_entry)->packed_key, *kmer_entry);
         }
     }
-
-    // if iteration has ended keep returning NULL for subsequent calls
-    if (entry == NULL || *entry == NULL)
-    {
-        table = NULL;
-        return NULL;
-    }
-
-    if (indirection)
-    {
-        return entry;
-    }
-    else
-    {
-        return *entry;
-    }
 }
 
 /*****************************************
  * Find possible kmer extensions and extend
 *****************************************/
 
+// appends entry to candidates, returns true once capacity candidates are found
+bool add_candidate(extension_candidate *candidates, int *count, int capacity, struct ZHashEntry *entry, struct ZHashTable *table, int mmer_score)
+{
+    candidates[*count].entry = entry;
+    candidates[*count].table = table;
+    candidates[*count].mmer_score = mmer_score;
+    return ++*count == capacity;
+}
+
 /**
  * Usage:
- * returns kmer information that overlaps at KMER_SIZE - 1 base pairs with given kmer entry key
- * returns entry and table of candidate kmer, NULL values of entry and table if no candidate is found
- * to be used when finding first extension for kmer
+ * finds entries of the compare mmer tables of key that overlap key at kmer_size - 1 base pairs
+ * they are the entries under the end of key in entry_heads going forward and entry_tails going backward
+ * so a single lookup finds them, the index also holds entries of other tables which are skipped
+ * returns number of entries found, stops once capacity entries are found
  * Arguments:
- * hash_table: pass mmer hashtable
- * entry: entry should contain kmer information that is to be extended
- * mmer_score: mmer_score of the kmer that is to be extended
- * forward: true to return candidate for right end extension and false to for left end extension
+ * key: kmer or unitig that is to be extended
+ * key_len: length of key
+ * forward: true to find right end extensions and false to find left end extensions
+ * max_score: compare mmers of a higher rank are skipped
+ * exclude: entry that is skipped, NULL to keep all entries
+ * candidates: set to the entries found along with their table and mmer score
+ * capacity: number of candidates that fit
  */
-kmer_extension_node find_kmer_extension(struct ZHashTable *hash_table, struct ZHashEntry *entry, int mmer_score, bool forward)
+int probe_candidates(char *key, int key_len, bool forward, int max_score, struct ZHashEntry *exclude, extension_candidate *candidates, int capacity)
 {
-    // initialize key structure
-    char *key = entry->key;
-    int key_len = strlen(key);
+    int count = 0;
 
-    // initialize signature mmer
-    char compare_mmer[MMER_SIZE + 1];
-    compare_mmer[MMER_SIZE] = '\0';
-    if (forward) {
-        // forward direction generates possible mmers from right end of kmer
-        strncpy(compare_mmer, &key[key_len - (MMER_SIZE - 1)], MMER_SIZE - 1);
-    } else {
-        // backward direction generated possible mmers from left end of kmer
-        strncpy(&compare_mmer[1], key, MMER_SIZE - 1);
-    }
-
-    bool multiple_extension = false;
-    struct ZHashEntry **extend_entry = NULL, **compare_entry = NULL;
-    struct ZHashTable *compare_mmer_hash = NULL, *extend_table = NULL;
+    // scores of the 4 mmers at the end of key extended by one base pair
+    int compare_scores[4];
+    extension_mmer_scores(key, key_len, forward, compare_scores);
 
-    // iterate over 4 possible compare mmers that can be created by changing one base pair
-    // on the right end for forward direction or the left end for backward direction
-    for (int i = 0; i < 4; i++)
+    uint64_t end[FHASH_MAX_KEY_WORDS];
+    pack_key_end(key, key_len, forward, end);
+    for (entry_end *node = fhash_get(forward ? entry_heads : entry_tails, end); node != NULL; node = node->next)
     {
-        if (forward) {
-            compare_mmer[MMER_SIZE - 1] = getbp(i);
-        } else {
-            compare_mmer[0] = getbp(i);
-        }
-
-        if (getscore(compare_mmer) > mmer_score)
+        // extension only with mmers visited before or at max_score
+        if (node->entry == exclude || mmer_rank(node->mmer_score) > mmer_rank(max_score))
         {
-            // extension only with lexicographically larger mmers
             continue;
         }
 
-        if ((compare_mmer_hash = (struct ZHashTable *)zhash_get(hash_table, compare_mmer)) == NULL)
+        for (int i = 0; i < 4; i++)
         {
-            // ignore if mmer does not have entry
-            continue;
-        }
-
-        // compare signature is lexicographically greater than or equal
-        while ((compare_entry = iterate_level_two_hash(compare_mmer_hash, true, false)) != NULL)
-        {
-            // handle equality case
-            if (*compare_entry == entry)
-                continue;
-
-            // check if KMER_SIZE - 1 characters overlap
-            if (!compare_overlap(key, (*compare_entry)->key, forward))
-                continue;
-
-            // if extension entry already exists
-            // there are multiple possible extensions
-            // unitig extension is not possible
-            if (extend_entry != NULL)
+            if (node->mmer_score == compare_scores[i])
             {
-                extend_entry = NULL;
-                extend_table = NULL;
-                multiple_extension = true;
+                if (add_candidate(candidates, &count, capacity, node->entry, node->table, node->mmer_score))
+                {
+                    return count;
+                }
                 break;
             }
-            else
-            {
-                extend_table = compare_mmer_hash;
-                extend_entry = compare_entry;
-            }
         }
+    }
 
-        if (multiple_extension)
-        {
-            break;
-        }
+    return count;
+}
+
+// returns pointer to the pointer of entry in table so that it can be unlinked
+struct ZHashEntry **locate_entry(struct ZHashTable *table, struct ZHashEntry *entry)
+{
+    struct ZHashEntry **link = &table->entries[zgenerate_hash(table, entry->key)];
+    while (*link != entry)
+    {
+        link = &(*link)->next;
     }
 
-    // deduct count from entry table
+    return link;
+}
+
+/**
+ * Usage:
+ * returns kmer information that overlaps at kmer_size - 1 base pairs with given kmer entry key
+ * returns entry and table of candidate kmer, NULL values of entry and table if no candidate is found
+ * to be used when finding first extension for kmer
+ * Arguments:
+ * entry: entry should contain kmer information that is to be extended
+ * mmer_score: mmer_score of the kmer that is to be extended
+ * forward: true to return candidate for right end extension and false to for left end extension
+ */
+kmer_extension_node find_kmer_extension(struct ZHashEntry *entry, int mmer_score, bool forward)
+{
+    // a second candidate means there are multiple possible extensions and unitig extension is not possible
+    // equal entry is skipped as a kmer cannot extend itself
+    extension_candidate candidates[2];
+    int count = probe_candidates(entry->key, entry->key_len, forward, mmer_score, entry, candidates, 2);
+
     kmer_extension_node to_return;
-    to_return.extend_entry = extend_entry;
-    to_return.extend_table = extend_table;
+    to_return.extend_entry = count == 1 ? locate_entry(candidates[0].table, candidates[0].entry) : NULL;
+    to_return.extend_table = count == 1 ? candidates[0].table : NULL;
     return to_return;
 }
 
 /**
  * Usage: 
- * returns kmer infromation that overlaps at KMER_SIZE - 1 base pairs with given kmer string
+ * returns kmer infromation that overlaps at kmer_size - 1 base pairs with given kmer string
  * returns entry and table of candidate kmer, NULL values of entry and table if no candidate is found
  * to be used when one extension has already been performed on a kmer
  * Arguments:
- * hash_table: pass mmer hashtable
  * key: pass kmer string that is to be extended
+ * key_len: length of key
  * mmer_score: mmer_score of the kmer that is to be extended
  * forward: true to return candidate for right end extension and false to for left end extension
  */
-kmer_extension_node more_kmer_extension(struct ZHashTable *hash_table, char *key, int mmer_score, bool forward)
+kmer_extension_node more_kmer_extension(char *key, int key_len, int mmer_score, bool forward)
 {
-    // initialize key structure
-    int key_len = strlen(key);
-
-    // initialize signature mmer
-    char compare_mmer[MMER_SIZE + 1];
-    compare_mmer[MMER_SIZE] = '\0';
-    if (forward) {
-        // forward direction generates possible mmers from right end of kmer
-        strncpy(compare_mmer, &key[key_len - (MMER_SIZE - 1)], MMER_SIZE - 1);
-    } else {
-        // backward direction generated possible mmers from left end of kmer
-        strncpy(&compare_mmer[1], key, MMER_SIZE - 1);
-    }
-
-    bool multiple_extension = false;
-    struct ZHashEntry **extend_entry = NULL, **compare_entry = NULL;
-    struct ZHashTable *compare_mmer_hash = NULL, *extend_table = NULL;
-
-    // iterate over 4 possible compare mmers that can be created by changing one base pair
-    // on the right end for forward direction or the left end for backward direction
-    for (int i = 0; i < 4; i++)
-    {
-        if (forward) {
-            compare_mmer[MMER_SIZE - 1] = getbp(i);
-        } else {
-            compare_mmer[0] = getbp(i);
-        }
-
-        if (getscore(compare_mmer) > mmer_score)
-        {
-            // extension only with lexicographically larger mmers
-            continue;
-        }
-
-        if ((compare_mmer_hash = (struct ZHashTable *)zhash_get(hash_table, compare_mmer)) == NULL)
-        {
-            // ignore if mmer does not have entry
-            continue;
-        }
-
-        // compare signature is lexicographically greater than or equal
-        while ((compare_entry = iterate_level_two_hash(compare_mmer_hash, true, false)) != NULL)
-        {
-            // check if KMER_SIZE - 1 characters overlap
-            if (!compare_overlap(key, (*compare_entry)->key, forward))
-                continue;
-
-            // if extension entry already exists
-            // there are multiple possible extensions
-            // unitig extension is not possible
-            if (extend_entry != NULL)
-            {
-                extend_entry = NULL;
-                extend_table = NULL;
-                multiple_extension = true;
-                break;
-            }
-            else
-            {
-                extend_table = compare_mmer_hash;
-                extend_entry = compare_entry;
-            }
-        }
-
-        if (multiple_extension)
-        {
-            break;
-        }
-    }
+    // a second candidate means there are multiple possible extensions and unitig extension is not possible
+    extension_candidate candidates[2];
+    int count = probe_candidates(key, key_len, forward, mmer_score, NULL, candidates, 2);
 
-    // deduct count from entry table
     kmer_extension_node to_return;
-    to_return.extend_entry = extend_entry;
-    to_return.extend_table = extend_table;
+    to_return.extend_entry = count == 1 ? locate_entry(candidates[0].table, candidates[0].entry) : NULL;
+    to_return.extend_table = count == 1 ? candidates[0].table : NULL;
     return to_return;
 }
 
@@ -658,524 +663,2205 @@ kmer_extension_node more_kmer_extension(struct ZHashTable *hash_table, char *key
  */
 void find_kmer_extensions(struct ZHashTable *hash_table, bool forward)
 {
-    // initialize signature kmer
-    char mmer[MMER_SIZE + 1];
-    mmer[0] = 'C';
-    mmer[MMER_SIZE] = '\0';
-    memset(&mmer[1], 'T', MMER_SIZE - 1);
-    char compare_mmer[MMER_SIZE + 1];
-    compare_mmer[MMER_SIZE] = '\0';
-    int mmer_score = getscore(mmer);
-    bool multiple_extension;
-    char *a_key;
-    int a_len;
-    int score_limit = getbp('A') * MMER_SIZE;
-
-    // iterate over all mmers from CTTT to AAAA..
-    struct ZHashTable *mmer_hash, *compare_mmer_hash, *extend_table;
-    struct ZHashEntry **kmer_entry, **compare_entry, **extend_entry = NULL;
-    bool not_extended = false;
-    while (mmer_score <= score_limit)
-    {
-        // perform operation till mmer reaches AAAA..
-        if ((mmer_hash = zhash_get(hash_table, mmer)) != NULL)
-        {
-            // iterate over all kmers of a particular mmer
-            int array_index = 0;
-            while (array_index < hash_sizes[mmer_hash->size_index])
+    // iterate over all mmers in increasing rank, from CTTT to AAAA.. in dictionary order
+    // a kmer only extends with entries of mmers visited before or at its own
+    int mmer_count;
+    int *mmers = ordered_mmers(hash_table, &mmer_count);
+    struct ZHashTable *mmer_hash;
+    struct ZHashEntry **extend_entry = NULL;
+    for (int mmer_index = 0; mmer_index < mmer_count; mmer_index++)
+    {
+        int mmer_score = mmers[mmer_index];
+        mmer_hash = zhash_get_packed(hash_table, mmer_score);
+        // iterate over all kmers of a particular mmer
+        int array_index = 0;
+        while (array_index < hash_sizes[mmer_hash->size_index])
+        {
+            struct ZHashEntry **kmer_entry = &mmer_hash->entries[array_index];
+            while (*kmer_entry != NULL)
             {
-                struct ZHashEntry **kmer_entry = &mmer_hash->entries[array_index];
-                while (*kmer_entry != NULL)
+                kmer_extension_node extension_node = find_kmer_extension(*kmer_entry, mmer_score, forward);
+
+                if (extension_node.extend_entry != NULL)
                 {
-                    kmer_extension_node extension_node = find_kmer_extension(hash_table, *kmer_entry, mmer_score, forward);
+                    // create first extension
+                    extend_entry = extension_node.extend_entry;
+                    more_kmer_extension_node further_extension = extend_kmers(*kmer_entry, *extend_entry, forward);
+                    unindex_entry(*kmer_entry);
+                    unindex_entry(*extend_entry);
+                    // cannot delete both nodes directly as extend entry node points to kmer entry
+                    if ((*extend_entry)->next == (*kmer_entry))
+                    {
+                        kmer_entry = extend_entry;
+                        struct ZHashEntry *temp = *kmer_entry;
+                        *kmer_entry = (*kmer_entry)->next;
+                        zfree_entry(temp, false); // free extension node
+                        temp = *kmer_entry;
+                        *kmer_entry = (*kmer_entry)->next;
+                        zfree_entry(temp, false); // free kmer node
+                        mmer_hash->entry_count -= 2;
+                    }
+                    // cannot delete both nodes directly as kmer entry points to extend entry node
+                    else if ((*kmer_entry)->next == (*extend_entry))
+                    {
+                        struct ZHashEntry *temp = *kmer_entry;
+                        *kmer_entry = (*kmer_entry)->next;
+                        zfree_entry(temp, false); // free kmer node
+                        temp = *kmer_entry;
+                        *kmer_entry = (*kmer_entry)->next;
+                        zfree_entry(temp, false); // free extension node
+                        mmer_hash->entry_count -= 2;
+                        // safe to delete
+                    }
+                    else
+                    {
+                        struct ZHashEntry *temp = *kmer_entry;
+                        *kmer_entry = (*kmer_entry)->next;
+                        zfree_entry(temp, false); // free kmer node
+                        mmer_hash->entry_count--;
+                        temp = *extend_entry;
+                        *extend_entry = (*extend_entry)->next;
+                        zfree_entry(temp, false); // free extension node
+                        extension_node.extend_table->entry_count--;
+                    }
 
-                    if (extension_node.extend_entry != NULL)
+                    // keep extending while possible
+                    while (true)
                     {
-                        // create first extension
-                        extend_entry = extension_node.extend_entry;
-                        more_kmer_extension_node further_extension = extend_kmers(*kmer_entry, *extend_entry, forward);
-                        // cannot delete both nodes directly as extend entry node points to kmer entry
-                        if ((*extend_entry)->next == (*kmer_entry))
+                        extension_node = more_kmer_extension(further_extension.key, further_extension.key_len, mmer_score, forward);
+                        if (extension_node.extend_entry == NULL)
                         {
-                            kmer_entry = extend_entry;
-                            struct ZHashEntry *temp = *kmer_entry;
-                            *kmer_entry = (*kmer_entry)->next;
-                            zfree_entry(temp, false); // free extension node
-                            temp = *kmer_entry;
-                            *kmer_entry = (*kmer_entry)->next;
-                            zfree_entry(temp, false); // free kmer node
-                            mmer_hash->entry_count -= 2;
+                            break;
                         }
-                        // cannot delete both nodes directly as kmer entry points to extend entry node
-                        else if ((*kmer_entry) == (*extend_entry)->next)
+
+                        extend_entry = extension_node.extend_entry;
+                        further_extension = further_extend_kmers(further_extension, *extend_entry, forward);
+                        unindex_entry(*extend_entry);
+                        // extension node and kmer entry iterator are the same
+                        if (*extend_entry == (*kmer_entry))
                         {
                             struct ZHashEntry *temp = *kmer_entry;
                             *kmer_entry = (*kmer_entry)->next;
-                            zfree_entry(temp, false); // free kmer node
-                            temp = *kmer_entry;
-                            *kmer_entry = (*kmer_entry)->next;
-                            zfree_entry(temp, false); // free extension node
-                            mmer_hash->entry_count -= 2;
-                            // safe to delete
+                            zfree_entry(temp, false);
                         }
-                        else
+                        // extension node points to kmer entry iterator
+                        else if ((*extend_entry)->next == *kmer_entry)
                         {
-                            struct ZHashEntry *temp = *kmer_entry;
-                            *kmer_entry = (*kmer_entry)->next;
-                            zfree_entry(temp, false); // free kmer node
-                            mmer_hash->entry_count--;
-                            temp = *extend_entry;
-                            *extend_entry = (*extend_entry)->next;
-                            zfree_entry(temp, false); // free extension node
-                            extension_node.extend_table->entry_count--;
+                            struct ZHashEntry *temp = *extend_entry;
+                            kmer_entry = extend_entry;
+                            *kmer_entry = (*extend_entry)->next;
+                            zfree_entry(temp, false);
                         }
-
-                        // keep extending while possible
-                        while (true)
+                        // kmer entry iterator points to extension node
+                        else
                         {
-                            extension_node = more_kmer_extension(hash_table, further_extension.key, mmer_score, forward);
-                            if (extension_node.extend_entry == NULL)
-                            {
-                                break;
-                            }
-
-                            extend_entry = extension_node.extend_entry;
-                            further_extension = further_extend_kmers(further_extension, *extend_entry, forward);
-                            // extension node and kmer entry iterator are the same
-                            if (*extend_entry == (*kmer_entry))
-                            {
-                                struct ZHashEntry *temp = *kmer_entry;
-                                *kmer_entry = (*kmer_entry)->next;
-                                zfree_entry(temp, false);
-                            }
-                            // extension node points to kmer entry iterator
-                            else if ((*extend_entry)->next == *kmer_entry)
-                            {
-                                struct ZHashEntry *temp = *extend_entry;
-                                kmer_entry = extend_entry;
-                                *kmer_entry = (*extend_entry)->next;
-                                zfree_entry(temp, false);
-                            }
-                            // kmer entry iterator points to extension node
-                            else
-                            {
-                                struct ZHashEntry *temp = *extend_entry;
-                                *extend_entry = (*extend_entry)->next;
-                                free(temp);
-                            }
+                            struct ZHashEntry *temp = *extend_entry;
+                            *extend_entry = (*extend_entry)->next;
+                            zfree_entry(temp, false);
                         }
-                        // add further extended node to hash table
-                        zhash_set(mmer_hash, further_extension.key, further_extension.read_id_lists);
                     }
-                    else
+                    // add further extended node to hash table
+                    zhash_set(mmer_hash, further_extension.key, further_extension.read_ids);
+                    index_entry(mmer_hash, mmer_score, *zhash_find_entry(mmer_hash, zgenerate_hash(mmer_hash, further_extension.key), further_extension.key));
+                    // hash table stores its own copy of the key
+                    free_extension_key(&further_extension);
+                }
+                else
+                {
+                    kmer_entry = &(*kmer_entry)->next;
+                }
+            }
+            array_index++;
+        }
+    }
+
+    free(mmers);
+}
+
+/*****************************************
+ * Compacted de Bruijn graph
+ * Alternative to find_kmer_extensions that merges kmers into maximal non-branching paths
+ * Each kmer records which of its 4 possible neighbours at either end exist, paths are then walked
+ * without modifying any table and only merged once all of them are known
+ * A kmer is stored either as itself or as its complement, so both are the same node of the graph
+*****************************************/
+
+// kmer in the de Bruijn graph of all kmers
+// masks are for the kmer as stored in entry
+typedef struct graph_node
+{
+    struct ZHashEntry *entry;
+    struct ZHashTable *table;
+    uint8_t in;  // bit per base pair prepended to the kmer that gives another kmer of the graph
+    uint8_t out; // bit per base pair appended to the kmer that gives another kmer of the graph
+    bool walked; // set once the kmer is on a path
+} graph_node;
+
+// node along with the strand it is walked on, flipped when walked as the complement of its key
+typedef struct graph_step
+{
+    graph_node *node;
+    bool flipped;
+} graph_step;
+
+typedef struct kmer_graph
+{
+    graph_node *nodes;
+    size_t count;
+    struct FHashTable *index; // packed kmer to its node
+} kmer_graph;
+
+// paths found by one worker, steps of path i are steps[ends[i - 1]] up to steps[ends[i]]
+typedef struct path_list
+{
+    graph_step *steps;
+    size_t node_count, node_capacity;
+    size_t *ends;
+    size_t path_count, path_capacity;
+} path_list;
+
+// worker thread of a graph phase, claims chunks of next_node until all nodes are claimed
+typedef struct graph_worker
+{
+    kmer_graph *graph;
+    size_t *next_node;
+    path_list paths;
+} graph_worker;
+
+#define GRAPH_CHUNK 1024 // nodes claimed by a graph worker at a time
+
+/**
+ * Usage:
+ * returns a node for every kmer of every mmer table, indexed by packed kmer
+ * to be called before extension while all entries are kmers
+ * Arguments:
+ * hash_table: pass mmer hash table
+ */
+kmer_graph *create_kmer_graph(struct ZHashTable *hash_table)
+{
+    struct ZHashIterator mmer_iterator, kmer_iterator;
+    struct ZHashEntry **mmer_entry, **kmer_entry;
+    uint64_t packed[FHASH_MAX_KEY_WORDS];
+    size_t count = 0;
+
+    zhash_iterate_init(&mmer_iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+    {
+        count += ((struct ZHashTable *)(*mmer_entry)->val)->entry_count;
+    }
+
+    kmer_graph *graph = malloc(sizeof(kmer_graph));
+    graph->nodes = calloc(count, sizeof(graph_node));
+    graph->count = 0;
+    graph->index = fcreate_hash_table(packed_words(kmer_size));
+
+    zhash_iterate_init(&mmer_iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+    {
+        zhash_iterate_init(&kmer_iterator, (*mmer_entry)->val);
+        while ((kmer_entry = zhash_iterate(&kmer_iterator)) != NULL)
+        {
+            graph_node *node = &graph->nodes[graph->count++];
+            node->entry = *kmer_entry;
+            node->table = (*mmer_entry)->val;
+            pack_kmer_words((*kmer_entry)->key, kmer_size, packed);
+            fhash_set(graph->index, packed, node);
+        }
+    }
+
+    return graph;
+}
+
+void free_kmer_graph(kmer_graph *graph)
+{
+    ffree_hash_table(graph->index);
+    free(graph->nodes);
+    free(graph);
+}
+
+// writes key of step on the strand it is walked on to kmer
+void step_key(graph_step step, char *kmer)
+{
+    for (int i = 0; i < kmer_size; i++)
+    {
+        kmer[i] = step.flipped ? getbp(3 - getval(step.node->entry->key[i])) : step.node->entry->key[i];
+    }
+}
+
+// returns mask of step on the strand it is walked on, complementing a base pair reverses the bits
+uint8_t step_mask(graph_step step, bool out)
+{
+    uint8_t mask = out ? step.node->out : step.node->in;
+    if (step.flipped)
+    {
+        mask = (mask & 1) << 3 | (mask & 2) << 1 | (mask & 4) >> 1 | (mask & 8) >> 3;
+    }
+
+    return mask;
+}
+
+// returns step to the kmer formed by appending bp to step going forward and prepending it going backward
+// node is NULL if neither that kmer nor its complement is in the graph
+graph_step graph_neighbour(kmer_graph *graph, graph_step step, int bp, bool forward)
+{
+    char key[MAX_KMER_SIZE], kmer[MAX_KMER_SIZE];
+    uint64_t packed[FHASH_MAX_KEY_WORDS];
+    graph_step next;
+
+    step_key(step, key);
+    if (forward)
+    {
+        memcpy(kmer, &key[1], kmer_size - 1);
+        kmer[kmer_size - 1] = getbp(bp);
+    }
+    else
+    {
+        kmer[0] = getbp(bp);
+        memcpy(&kmer[1], key, kmer_size - 1);
+    }
+
+    pack_kmer_words(kmer, kmer_size, packed);
+    next.flipped = false;
+    if ((next.node = fhash_get(graph->index, packed)) == NULL)
+    {
+        for (int i = 0; i < kmer_size; i++)
+        {
+            kmer[i] = getbp(3 - getval(kmer[i]));
+        }
+        pack_kmer_words(kmer, kmer_size, packed);
+        next.flipped = true;
+        next.node = fhash_get(graph->index, packed);
+    }
+
+    return next;
+}
+
+// returns the step after step on a non-branching path in the given direction
+// node is NULL if step has no single neighbour that has step as its single neighbour
+graph_step next_on_path(kmer_graph *graph, graph_step step, bool forward)
+{
+    graph_step next = {NULL, false};
+    uint8_t mask = step_mask(step, forward);
+    if (__builtin_popcount(mask) != 1)
+    {
+        return next;
+    }
+
+    next = graph_neighbour(graph, step, __builtin_ctz(mask), forward);
+    if (next.node == step.node || __builtin_popcount(step_mask(next, !forward)) != 1)
+    {
+        next.node = NULL;
+    }
+
+    return next;
+}
+
+// claims the next chunk of nodes for a worker, returns false once all nodes are claimed
+bool claim_graph_chunk(graph_worker *worker, size_t *start, size_t *end)
+{
+    *start = __atomic_fetch_add(worker->next_node, GRAPH_CHUNK, __ATOMIC_RELAXED);
+    *end = MIN(*start + GRAPH_CHUNK, worker->graph->count);
+    return *start < worker->graph->count;
+}
+
+// thread body setting the neighbour masks of the nodes it claims
+void *graph_mask_run(void *arg)
+{
+    graph_worker *worker = arg;
+    size_t start, end;
+
+    while (claim_graph_chunk(worker, &start, &end))
+    {
+        for (size_t i = start; i < end; i++)
+        {
+            graph_step step = {&worker->graph->nodes[i], false};
+            for (int bp = 0; bp < 4; bp++)
+            {
+                if (graph_neighbour(worker->graph, step, bp, true).node != NULL)
+                {
+                    step.node->out |= 1 << bp;
+                }
+                if (graph_neighbour(worker->graph, step, bp, false).node != NULL)
+                {
+                    step.node->in |= 1 << bp;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// appends the path going forward from start, on the strand it is stored on, to paths and marks its nodes as walked
+// paths of a single kmer are not kept as there is nothing to merge
+void walk_path(kmer_graph *graph, graph_node *start, path_list *paths)
+{
+    size_t first = paths->node_count;
+    graph_step step = {start, false};
+
+    // cycles are walked once around, ending when start is reached on either strand
+    do
+    {
+        step.node->walked = true;
+        if (paths->node_count == paths->node_capacity)
+        {
+            paths->node_capacity = MAX(2 * paths->node_capacity, (size_t)64);
+            paths->steps = realloc(paths->steps, paths->node_capacity * sizeof(graph_step));
+        }
+        paths->steps[paths->node_count++] = step;
+    } while ((step = next_on_path(graph, step, true)).node != NULL && step.node != start);
+
+    if (paths->node_count - first == 1)
+    {
+        paths->node_count = first;
+        return;
+    }
+
+    if (paths->path_count == paths->path_capacity)
+    {
+        paths->path_capacity = MAX(2 * paths->path_capacity, (size_t)64);
+        paths->ends = realloc(paths->ends, paths->path_capacity * sizeof(size_t));
+    }
+    paths->ends[paths->path_count++] = paths->node_count;
+}
+
+// thread body walking the paths that start at the nodes it claims
+// a node starts a path when it does not follow another node on one, so every path has a single owner
+void *graph_walk_run(void *arg)
+{
+    graph_worker *worker = arg;
+    size_t start, end;
+
+    while (claim_graph_chunk(worker, &start, &end))
+    {
+        for (size_t i = start; i < end; i++)
+        {
+            graph_step step = {&worker->graph->nodes[i], false};
+            if (next_on_path(worker->graph, step, false).node == NULL)
+            {
+                walk_path(worker->graph, step.node, &worker->paths);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// runs body on threads workers over all nodes of graph, returns the workers for their paths
+graph_worker *run_graph_workers(kmer_graph *graph, int threads, void *(*body)(void *))
+{
+    graph_worker *workers = calloc(threads, sizeof(graph_worker));
+    pthread_t *thread_ids = malloc(threads * sizeof(pthread_t));
+    size_t next_node = 0;
+
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i].graph = graph;
+        workers[i].next_node = &next_node;
+        pthread_create(&thread_ids[i], NULL, body, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(thread_ids[i], NULL);
+    }
+
+    free(thread_ids);
+    return workers;
+}
+
+// merges the kmers of a path into one unitig stored in the table of its first kmer
+// read ids are kept by position, which complementing a kmer does not change
+void compact_path(graph_step *path, size_t length)
+{
+    char flipped_key[MAX_KMER_SIZE + 1];
+    struct ZHashEntry flipped_entry;
+    flipped_key[kmer_size] = '\0';
+    flipped_entry.key = flipped_key;
+    flipped_entry.key_len = kmer_size;
+
+    // first kmer of a path is walked on its stored strand
+    more_kmer_extension_node unitig;
+    for (size_t i = 1; i < length; i++)
+    {
+        struct ZHashEntry *entry = path[i].node->entry;
+        if (path[i].flipped)
+        {
+            step_key(path[i], flipped_key);
+            flipped_entry.val = entry->val;
+            entry = &flipped_entry;
+        }
+
+        unitig = i == 1 ? extend_kmers(path[0].node->entry, entry, true) : further_extend_kmers(unitig, entry, true);
+    }
+
+    // read ids of the kmers now belong to the unitig
+    for (size_t i = 0; i < length; i++)
+    {
+        zhash_delete(path[i].node->table, path[i].node->entry->key);
+    }
+
+    zhash_set(path[0].node->table, unitig.key, unitig.read_ids);
+    // hash table stores its own copy of the key
+    free_extension_key(&unitig);
+}
+
+/**
+ * Usage:
+ * replaces all kmers with the unitigs of the compacted de Bruijn graph of the kmers
+ * a unitig is a maximal path where each kmer but the last has a single next kmer which has it as its single previous kmer
+ * a kmer and its complement are one node, the reverse complement is a different node as kmers are stored per strand
+ * masks and paths are found by threads workers without modifying the tables, unitigs are merged after
+ * Arguments:
+ * hash_table: pass mmer hash table
+ * threads: number of worker threads
+ */
+void compact_kmer_graph(struct ZHashTable *hash_table, int threads)
+{
+    kmer_graph *graph = create_kmer_graph(hash_table);
+    free(run_graph_workers(graph, threads, graph_mask_run));
+    graph_worker *workers = run_graph_workers(graph, threads, graph_walk_run);
+
+    // kmers left over are on cycles where every kmer follows another, each is walked from its first kmer
+    path_list cycles = {0};
+    for (size_t i = 0; i < graph->count; i++)
+    {
+        if (!graph->nodes[i].walked)
+        {
+            walk_path(graph, &graph->nodes[i], &cycles);
+        }
+    }
+
+    for (int i = 0; i <= threads; i++)
+    {
+        path_list *paths = i < threads ? &workers[i].paths : &cycles;
+        for (size_t path = 0, first = 0; path < paths->path_count; first = paths->ends[path++])
+        {
+            compact_path(&paths->steps[first], paths->ends[path] - first);
+        }
+        free(paths->steps);
+        free(paths->ends);
+    }
+
+    free(workers);
+    free_kmer_graph(graph);
+}
+
+/*****************************************
+ * Debugger functions for printing information in mmer hash table
+ * TODO: Add more functions to print more information
+*****************************************/
+
+// Usage: prints all mmers along with their kmers and reads ids
+// Arguments: pass mmer hash table
+void print_kmer_read_ids(struct ZHashTable *hash_table)
+{
+    struct ZHashIterator mmer_iterator, kmer_iterator;
+    struct ZHashEntry **mmer_entry, **kmer_entry;
+    read_id_run *runs, *run;
+    int offset, id, i;
+    char mmer[MAX_MMER_SIZE + 1];
+
+    zhash_iterate_init(&mmer_iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+    {
+        unpack_kmer((*mmer_entry)->packed_key, mmer_size, mmer);
+        printf("%s\n", mmer); // print mmer
+        // iterate over all kmers of mmer
+        zhash_iterate_init(&kmer_iterator, (*mmer_entry)->val);
+        while ((kmer_entry = zhash_iterate(&kmer_iterator)) != NULL)
+        {
+            printf("%s\n", (*kmer_entry)->key);
+            runs = run = unitig_read_ids(*kmer_entry);
+            // iterate over read id runs, each base pair of a run has the same read ids
+            while (run != NULL)
+            {
+                for (i = 0; i < run->length; i++)
+                {
+                    // print each read id of base pair in same line
+                    offset = id = 0;
+                    while (next_read_id(run->ids, &offset, &id))
                     {
-                        kmer_entry = &(*kmer_entry)->next;
+                        printf("%d ", id);
                     }
+                    printf("\n");
                 }
-                array_index++;
+                run = run->next;
+            }
+            free_unitig_read_ids(runs);
+        }
+        printf("\n");
+    }
+}
+
+// Usage: prints to stderr how many mmer buckets hold 1, 2-3, 4-7, ... kmers and the share of the largest bucket
+// shows how evenly the signature order spreads kmers, to be called after pruning while kmer tables are packed
+// Arguments: pass mmer hash table
+void print_bucket_histogram(struct ZHashTable *hash_table)
+{
+    struct ZHashIterator iterator;
+    struct ZHashEntry **mmer_entry;
+    size_t buckets[64] = {0};
+    size_t kmers = 0, largest = 0;
+    int top = 0;
+
+    zhash_iterate_init(&iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&iterator)) != NULL)
+    {
+        size_t count = ((struct FHashTable *)(*mmer_entry)->val)->entry_count;
+        if (count == 0)
+        {
+            continue;
+        }
+
+        int bin = 63 - __builtin_clzll(count);
+        buckets[bin]++;
+        top = MAX(top, bin);
+        kmers += count;
+        largest = MAX(largest, count);
+    }
+
+    fprintf(stderr, "%zu kmers in %zu mmer buckets, largest bucket holds %zu (%.1f%%)\n", kmers, hash_table->entry_count, largest, kmers > 0 ? 100.0 * largest / kmers : 0.0);
+    fprintf(stderr, "kmers per bucket\tbuckets\n");
+    for (int bin = 0; bin <= top && kmers > 0; bin++)
+    {
+        fprintf(stderr, "%zu-%zu\t%zu\n", (size_t)1 << bin, ((size_t)2 << bin) - 1, buckets[bin]);
+    }
+}
+
+// Usage: prints all kmers
+// Arguments: pass mmer hash table
+void print_kmers(struct ZHashTable *hash_table)
+{
+    struct ZHashIterator mmer_iterator, kmer_iterator;
+    struct ZHashEntry **mmer_entry, **kmer_entry;
+
+    // iterate over all mmers in hash table
+    zhash_iterate_init(&mmer_iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+    {
+        // iterate over all kmers of mmer
+        zhash_iterate_init(&kmer_iterator, (*mmer_entry)->val);
+        while ((kmer_entry = zhash_iterate(&kmer_iterator)) != NULL)
+        {
+            printf("%s\n", (*kmer_entry)->key);
+        }
+    }
+}
+
+/*****************************************
+ * Process reads to populate kmer and mmer hash table
+ * Perform pruning and deletion of low abundance kmers
+*****************************************/
+
+/**
+ * Usage:
+ * replaces the packed kmer hash table of every mmer with one keyed by kmer strings
+ * to be called before extension because unitigs outgrow a packed kmer
+ * Arguments:
+ * pass mmer hash table
+ */
+void unpack_kmer_tables(struct ZHashTable *hash_table)
+{
+    struct ZHashIterator mmer_iterator;
+    struct ZHashEntry **mmer_entry;
+    struct FHashTable *kmer_hash;
+    struct FHashIterator iterator;
+    struct FHashSlot *kmer_slot;
+    struct ZHashTable *string_hash;
+    char kmer_key[MAX_KMER_SIZE + 1];
+
+    zhash_iterate_init(&mmer_iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+    {
+        kmer_hash = (*mmer_entry)->val;
+        string_hash = zcreate_hash_table();
+        fhash_iterate_init(&iterator, kmer_hash);
+        while ((kmer_slot = fhash_iterate(&iterator)) != NULL)
+        {
+            unpack_kmer_words(kmer_slot->key, kmer_size, kmer_key);
+            zhash_set(string_hash, kmer_key, kmer_slot->val);
+        }
+        ffree_hash_table(kmer_hash);
+        (*mmer_entry)->val = string_hash;
+    }
+}
+
+/**
+ * Usage:
+ * turns read id list of each kmer into a single run covering all its base pairs
+ * the list is not copied per base pair, unitigs keep the runs of their kmers as read_id_spans
+ * to be called after pruning so that only abundant kmers have read ids expanded
+ * Arguments:
+ * pass mmer hash table
+ */
+void expand_read_id_list(struct ZHashTable *hashtable)
+{
+    struct ZHashIterator mmer_iterator, kmer_iterator;
+    struct ZHashEntry **mmer_entry, **kmer_entry;
+    read_id_list *read_ids;
+    zhash_iterate_init(&mmer_iterator, hashtable);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+    {
+        zhash_iterate_init(&kmer_iterator, (*mmer_entry)->val);
+        while ((kmer_entry = zhash_iterate(&kmer_iterator)) != NULL)
+        {
+            // copy drops the spare capacity left from ingestion, lists of a snapshot belong to its mapping
+            read_ids = duplicate_read_id_list((*kmer_entry)->val, extension_arena);
+            if (kmer_snapshot == NULL)
+            {
+                free_read_id_list((*kmer_entry)->val, NULL);
             }
+            (*kmer_entry)->val = create_read_id_spans(create_read_id_run((*kmer_entry)->key_len, read_ids, extension_arena), extension_arena);
+        }
+    }
+}
+
+// returns empty first level table from mmer scores to kmer tables
+// a mmer score indexes its slot directly unless 4^mmer_size slots would take more than 8 MB
+struct ZHashTable *create_mmer_table(void)
+{
+    if (mmer_size <= DIRECT_MMER_SIZE)
+    {
+        return zcreate_direct_hash_table((size_t)1 << 2 * mmer_size);
+    }
+
+    return zcreate_packed_hash_table();
+}
+
+/**
+ * Usage:
+ * stores read id in the read id list of kmer
+ * kmers are stored in 2 level hashing
+ * first level is hashed by signature of kmer i.e. a mmer
+ * second level is hashed by kmer itself
+ * read ids of a kmer must be stored in increasing order
+ * Arguments:
+ * hash_table: mmer hash table
+ * mmer: packed signature of kmer
+ * kmer: packed kmer
+ * read_id: id of read containing the kmer
+ */
+void store_kmer(struct ZHashTable *hash_table, int mmer, const uint64_t *kmer, int read_id)
+{
+    // check if this mmer has been stored before
+    // if not create a new hash table to store kmers for this signature
+    struct FHashTable *kmer_storage;
+    if ((kmer_storage = zhash_get_packed(hash_table, mmer)) == NULL)
+    {
+        kmer_storage = fcreate_hash_table(packed_words(kmer_size));
+        zhash_set_packed(hash_table, mmer, kmer_storage);
+    }
+
+    // check if this kmer has been stored previously
+    read_id_list *read_ids, *grown;
+    if ((read_ids = fhash_get(kmer_storage, kmer)) == NULL)
+    {
+        // create entry for the first time
+        fhash_set(kmer_storage, kmer, create_read_id_list(read_id));
+    }
+    else if ((grown = append_read_id(read_ids, read_id)) != read_ids)
+    {
+        // list was moved to grow it, store the new location
+        fhash_set(kmer_storage, kmer, grown);
+    }
+}
+
+// returns false if kmer_sketch shows that kmer will be pruned
+// read ids of a kmer are counted once per occurrence, so the estimate is never below their count
+bool passes_sketch(const uint64_t *kmer)
+{
+    if (kmer_sketch == NULL)
+    {
+        return true;
+    }
+
+    int estimate = csketch_estimate(kmer_sketch, kmer);
+    return estimate == SKETCH_MAX || estimate > abundance_cutoff;
+}
+
+// stores kmer in the mmer hash table or writes it to its bin when kmers are binned on disk
+void store_or_bin_kmer(struct ZHashTable *hash_table, int mmer, const uint64_t *kmer, int read_id)
+{
+    if (kmer_bins == NULL)
+    {
+        store_kmer(hash_table, mmer, kmer, read_id);
+        return;
+    }
+
+    kmer_record record;
+    memcpy(record.kmer, kmer, sizeof(record.kmer));
+    record.mmer = mmer;
+    record.read_id = read_id;
+    write_bin_record(kmer_bins, mmer % kmer_bins->count, &record);
+}
+
+// returns bits of word w used by a kmer packed into words, 0 for words beyond it
+uint64_t packed_word_mask(int w)
+{
+    int bits = 2 * kmer_size - 64 * w;
+    return bits >= 64 ? ~0ULL : bits > 0 ? ~0ULL >> (64 - bits) : 0;
+}
+
+// makes run a super-kmer holding only kmer
+void start_superkmer(superkmer_record *run, int mmer, const uint64_t *kmer, int read_id)
+{
+    memset(run->bases, 0, sizeof(run->bases));
+    memcpy(run->bases, kmer, FHASH_MAX_KEY_WORDS * sizeof(uint64_t));
+    run->mmer = mmer;
+    run->read_id = read_id;
+    run->kmers = 1;
+}
+
+/**
+ * Usage:
+ * appends the last base pair of kmer to run if kmer follows the last kmer of run
+ * kmer follows when it has the same signature and read and its first kmer_size - 1 base pairs
+ * are the last ones of run, kmers in between that were skipped do not matter then
+ * returns false if kmer has to start a new super-kmer
+ */
+bool extend_superkmer(superkmer_record *run, int mmer, const uint64_t *kmer, int read_id)
+{
+    if (run->kmers == 0 || run->mmer != mmer || run->read_id != read_id || kmer_size + run->kmers > SUPERKMER_WORDS * 32)
+    {
+        return false;
+    }
+
+    // last kmer of run shifted by the last base pair of kmer
+    for (int w = 0; w < FHASH_MAX_KEY_WORDS; w++)
+    {
+        uint64_t shifted = (run->bases[w] << 2) | (w > 0 ? run->bases[w - 1] >> 62 : kmer[0] & 3);
+        if ((shifted & packed_word_mask(w)) != kmer[w])
+        {
+            return false;
+        }
+    }
+
+    for (int w = SUPERKMER_WORDS - 1; w > 0; w--)
+    {
+        run->bases[w] = (run->bases[w] << 2) | (run->bases[w - 1] >> 62);
+    }
+    run->bases[0] = (run->bases[0] << 2) | (kmer[0] & 3);
+    run->kmers++;
+    return true;
+}
+
+// copies kmer i of run, counting from its first base pair, to kmer
+void superkmer_kmer(const superkmer_record *run, int i, uint64_t *kmer)
+{
+    // kmer i ends kmers - 1 - i base pairs before the end of run
+    int shift = 2 * (run->kmers - 1 - i);
+    int offset = shift / 64, bits = shift % 64;
+
+    for (int w = 0; w < FHASH_MAX_KEY_WORDS; w++)
+    {
+        uint64_t low = w + offset < SUPERKMER_WORDS ? run->bases[w + offset] >> bits : 0;
+        uint64_t high = bits > 0 && w + offset + 1 < SUPERKMER_WORDS ? run->bases[w + offset + 1] << (64 - bits) : 0;
+        kmer[w] = (low | high) & packed_word_mask(w);
+    }
+}
+
+// stores every kmer of run in order of position
+void store_superkmer(struct ZHashTable *hash_table, const superkmer_record *run)
+{
+    uint64_t kmer[FHASH_MAX_KEY_WORDS];
+
+    for (int i = 0; i < run->kmers; i++)
+    {
+        superkmer_kmer(run, i, kmer);
+        store_kmer(hash_table, run->mmer, kmer, run->read_id);
+    }
+}
+
+// stores kmers of run in the mmer hash table or writes run to its bin when kmers are binned on disk
+void store_or_bin_superkmer(struct ZHashTable *hash_table, const superkmer_record *run)
+{
+    if (kmer_bins == NULL)
+    {
+        store_superkmer(hash_table, run);
+        return;
+    }
+
+    write_bin_record(kmer_bins, run->mmer % kmer_bins->count, run);
+}
+
+// returns bytes of the records kmers are buffered and binned in
+size_t kmer_record_size(void)
+{
+    return super_kmers ? sizeof(superkmer_record) : sizeof(kmer_record);
+}
+
+// stores count buffered kmer_record or superkmer_record records, or bins them
+void store_or_bin_records(struct ZHashTable *hash_table, const void *records, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (super_kmers)
+        {
+            store_or_bin_superkmer(hash_table, &((const superkmer_record *)records)[i]);
+        }
+        else
+        {
+            const kmer_record *record = &((const kmer_record *)records)[i];
+            store_or_bin_kmer(hash_table, record->mmer, record->kmer, record->read_id);
+        }
+    }
+}
+
+// kmer_sink that stores kmers in the mmer hash table passed as sink_data
+void store_kmer_sink(void *sink_data, int mmer, const uint64_t *kmer, int read_id)
+{
+    if (passes_sketch(kmer))
+    {
+        store_or_bin_kmer((struct ZHashTable *)sink_data, mmer, kmer, read_id);
+    }
+}
+
+// table kmers of a read go to along with the super-kmer they are being merged into
+typedef struct superkmer_sink_data
+{
+    struct ZHashTable *hash_table;
+    superkmer_record run;
+} superkmer_sink_data;
+
+// kmer_sink that merges kmers into super-kmers and stores or bins each one once it ends
+// the last one of a read is left in sink_data
+void store_superkmer_sink(void *sink_data, int mmer, const uint64_t *kmer, int read_id)
+{
+    superkmer_sink_data *data = sink_data;
+
+    if (passes_sketch(kmer) && !extend_superkmer(&data->run, mmer, kmer, read_id))
+    {
+        if (data->run.kmers > 0)
+        {
+            store_or_bin_superkmer(data->hash_table, &data->run);
+        }
+        start_superkmer(&data->run, mmer, kmer, read_id);
+    }
+}
+
+// kmer_sink that counts kmers in the sketch passed as sink_data
+void count_kmer_sink(void *sink_data, int mmer, const uint64_t *kmer, int read_id)
+{
+    (void)mmer;
+    (void)read_id;
+    csketch_add((struct CSketch *)sink_data, kmer);
+}
+
+/**
+ * Usage:
+ * parses all kmers of a read and passes each with its signature to sink
+ * each mmer counts as the higher scoring of itself and its complement, its canonical form
+ * signature is the leftmost canonical mmer of the kmer with the highest mmer_rank
+ * kmer is passed as its complement if complement of signature has higher score
+ * packed kmer and mmer are rolled one base pair at a time and candidate signatures are kept
+ * in a deque with decreasing scores, so each base pair takes constant amortized work
+ * base pairs are encoded in chunks with encode_bases, kmers containing other characters are skipped
+ * inlined into the kernels below so that k and the number of packed words are constants
+ * Arguments:
+ * read: read from which kmers are be parsed, need not be null terminated
+ * read_len: number of base pairs in read
+ * read_id: id passed along with every kmer
+ * sink: called for every kmer in order of position in read
+ * sink_data: passed to sink
+ * k: kmer size
+ * wide: true if kmers take two words, k must be over 32 then and at most 32 otherwise
+ */
+static inline __attribute__((always_inline)) void extract_kmers_of_size(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data, const int k, const bool wide)
+{
+    // packed kmer ending at current base pair, high word only holds base pairs beyond the last 32
+    // xor with the masks complements every base pair
+    uint64_t kmer_low = 0, kmer_high = 0;
+    const uint64_t low_mask = wide ? ~0ULL : ~0ULL >> (64 - 2 * k);
+    const uint64_t high_mask = wide ? ~0ULL >> (128 - 2 * k) : 0;
+    uint64_t kmer[FHASH_MAX_KEY_WORDS] = {0};
+
+    // packed mmer ending at current base pair
+    uint32_t mmer = 0;
+    const uint32_t mmer_mask = ((uint32_t)1 << 2 * mmer_size) - 1;
+
+    // ring buffer of mmers that can still become signature, front has the highest rank
+    // an mmer is dropped once a later mmer ranks higher or it leaves the kmer
+    const int window = k - mmer_size + 1;
+    int positions[MAX_KMER_SIZE];
+    int scores[MAX_KMER_SIZE];
+    int ranks[MAX_KMER_SIZE];
+    bool is_rev[MAX_KMER_SIZE];
+    int front = 0, count = 0;
+    int i, back, score, rev_score, rank;
+
+    // codes of the current chunk of read and number of valid base pairs ending at current one
+    uint8_t codes[ENCODE_CHUNK];
+    int valid = 0;
+
+    for (i = 0; i < read_len; i++)
+    {
+        if (i % ENCODE_CHUNK == 0)
+        {
+            encode_bases(&read[i], MIN(ENCODE_CHUNK, read_len - i), codes);
+        }
+
+        int val = codes[i % ENCODE_CHUNK];
+        if (val == BASE_INVALID)
+        {
+            // no kmer or mmer can contain this character, start over after it
+            valid = 0;
+            count = 0;
+            continue;
+        }
+        valid++;
+
+        if (wide)
+        {
+            kmer_high = ((kmer_high << 2) | (kmer_low >> 62)) & high_mask;
+        }
+        kmer_low = ((kmer_low << 2) | val) & low_mask;
+        mmer = ((mmer << 2) | val) & mmer_mask;
+
+        if (valid < mmer_size)
+        {
+            continue;
+        }
+
+        // complement of a packed mmer flips both bits of every base pair
+        score = mmer;
+        rev_score = mmer ^ mmer_mask;
+
+        // drop signature that is no longer part of the kmer ending at current base pair
+        if (count > 0 && positions[front] <= i - k)
+        {
+            front = (front + 1) % window;
+            count--;
+        }
+
+        // equal ranks are kept so that the leftmost mmer stays in front
+        rank = mmer_rank(MAX(score, rev_score));
+        while (count > 0 && ranks[(front + count - 1) % window] < rank)
+        {
+            count--;
+        }
+        back = (front + count) % window;
+        positions[back] = i - (mmer_size - 1);
+        scores[back] = MAX(score, rev_score);
+        ranks[back] = rank;
+        is_rev[back] = rev_score > score;
+        count++;
+
+        if (valid < k)
+        {
+            continue;
+        }
+
+        // kmer is stored as complement if complement of signature has higher score
+        kmer[0] = is_rev[front] ? kmer_low ^ low_mask : kmer_low;
+        if (wide)
+        {
+            kmer[1] = is_rev[front] ? kmer_high ^ high_mask : kmer_high;
+        }
+        sink(sink_data, scores[front], kmer, read_id);
+    }
+}
+
+// kernels for common kmer sizes and generic ones for the rest
+static void extract_kmers_21(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data)
+{
+    extract_kmers_of_size(read, read_len, read_id, sink, sink_data, 21, false);
+}
+
+static void extract_kmers_31(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data)
+{
+    extract_kmers_of_size(read, read_len, read_id, sink, sink_data, 31, false);
+}
+
+static void extract_kmers_47(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data)
+{
+    extract_kmers_of_size(read, read_len, read_id, sink, sink_data, 47, true);
+}
+
+static void extract_kmers_63(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data)
+{
+    extract_kmers_of_size(read, read_len, read_id, sink, sink_data, 63, true);
+}
+
+static void extract_kmers_narrow(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data)
+{
+    extract_kmers_of_size(read, read_len, read_id, sink, sink_data, kmer_size, false);
+}
+
+static void extract_kmers_wide(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data)
+{
+    extract_kmers_of_size(read, read_len, read_id, sink, sink_data, kmer_size, true);
+}
+
+// kernel used by extract_kmers, chosen by select_kmer_extractor once kmer_size is known
+static kmer_extractor kmer_extractor_kernel = extract_kmers_31;
+
+// picks the kernel for kmer_size
+void select_kmer_extractor(void)
+{
+    switch (kmer_size)
+    {
+    case 21:
+        kmer_extractor_kernel = extract_kmers_21;
+        break;
+    case 31:
+        kmer_extractor_kernel = extract_kmers_31;
+        break;
+    case 47:
+        kmer_extractor_kernel = extract_kmers_47;
+        break;
+    case 63:
+        kmer_extractor_kernel = extract_kmers_63;
+        break;
+    default:
+        kmer_extractor_kernel = kmer_size > 32 ? extract_kmers_wide : extract_kmers_narrow;
+    }
+}
+
+// parses all kmers of a read and passes each with its signature to sink, see extract_kmers_of_size
+void extract_kmers(char *read, int read_len, int read_id, kmer_sink sink, void *sink_data)
+{
+    kmer_extractor_kernel(read, read_len, read_id, sink, sink_data);
+}
+
+/**
+ * Usage:
+ * stores all kmers of a read
+ * Arguments:
+ * hash_table: mmer hash table
+ * read: read from which kmers are be parsed and stored
+ * read_len: number of base pairs in read
+ * read_id: for debugging purposes
+ */
+struct ZHashTable *process_read(struct ZHashTable *hash_table, char *read, int read_len, int read_id)
+{
+    if (super_kmers)
+    {
+        superkmer_sink_data data = {hash_table, {.kmers = 0}};
+        extract_kmers(read, read_len, read_id, store_superkmer_sink, &data);
+        if (data.run.kmers > 0)
+        {
+            store_or_bin_superkmer(hash_table, &data.run);
+        }
+        return hash_table;
+    }
+
+    extract_kmers(read, read_len, read_id, store_kmer_sink, hash_table);
+    return hash_table;
+}
+
+/*****************************************
+ * Parallel ingestion of reads
+ * Worker threads parse a batch of reads and route every kmer to the shard owning its mmer
+ * Each shard has its own mmer hash table which is only touched by the worker owning the shard
+*****************************************/
+
+// growable buffer of kmers parsed by one worker for one shard
+// kmers are merged into runs instead of records when super_kmers is set
+typedef struct kmer_buffer
+{
+    kmer_record *records;
+    superkmer_record *runs;
+    int count;
+    int capacity;
+} kmer_buffer;
+
+// state shared by the reading thread and all workers
+typedef struct ingest_state
+{
+    int threads;
+    char **reads;                  // reads of the current batch, pointing into the read file
+    int *read_lens;
+    int read_count;
+    int first_read_id;             // read ids of a batch are consecutive
+    bool done;                     // set when input is exhausted
+    kmer_buffer *buffers;          // buffer of worker w for shard s at w * threads + s
+    struct ZHashTable **shards;    // mmer hash table of each shard
+    pthread_barrier_t batch_read;
+    pthread_barrier_t batch_parsed;
+    pthread_barrier_t batch_stored;
+} ingest_state;
+
+typedef struct ingest_worker
+{
+    ingest_state *state;
+    int id;
+    kmer_sink sink;         // receives kmers parsed by this worker
+    void *sink_data;
+} ingest_worker;
+
+// appends kmer to buffer, growing it if needed
+void append_kmer_record(kmer_buffer *buffer, int mmer, const uint64_t *kmer, int read_id)
+{
+    if (buffer->count == buffer->capacity)
+    {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        buffer->records = realloc(buffer->records, buffer->capacity * sizeof(kmer_record));
+    }
+
+    memcpy(buffer->records[buffer->count].kmer, kmer, sizeof(buffer->records[buffer->count].kmer));
+    buffer->records[buffer->count].mmer = mmer;
+    buffer->records[buffer->count].read_id = read_id;
+    buffer->count++;
+}
+
+// appends kmer to the last super-kmer of buffer or starts a new one, growing buffer if needed
+void append_superkmer_record(kmer_buffer *buffer, int mmer, const uint64_t *kmer, int read_id)
+{
+    if (buffer->count > 0 && extend_superkmer(&buffer->runs[buffer->count - 1], mmer, kmer, read_id))
+    {
+        return;
+    }
+
+    if (buffer->count == buffer->capacity)
+    {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        buffer->runs = realloc(buffer->runs, buffer->capacity * sizeof(superkmer_record));
+    }
+
+    start_superkmer(&buffer->runs[buffer->count++], mmer, kmer, read_id);
+}
+
+// appends kmer to buffer as a record or as part of a super-kmer
+void buffer_kmer(kmer_buffer *buffer, int mmer, const uint64_t *kmer, int read_id)
+{
+    if (super_kmers)
+    {
+        append_superkmer_record(buffer, mmer, kmer, read_id);
+    }
+    else
+    {
+        append_kmer_record(buffer, mmer, kmer, read_id);
+    }
+}
+
+// returns buffered records of buffer, see store_or_bin_records
+void *buffered_records(kmer_buffer *buffer)
+{
+    return super_kmers ? (void *)buffer->runs : (void *)buffer->records;
+}
+
+// kmer_sink that appends kmer to the buffer of the shard owning its mmer
+// sink_data points to the row of buffers of the parsing worker
+void buffer_kmer_sink(void *sink_data, int mmer, const uint64_t *kmer, int read_id)
+{
+    ingest_worker *worker = sink_data;
+    int shards = worker->state->threads;
+
+    if (passes_sketch(kmer))
+    {
+        buffer_kmer(&worker->state->buffers[worker->id * shards + mmer % shards], mmer, kmer, read_id);
+    }
+}
+
+/**
+ * Usage:
+ * thread body of an ingestion worker, loops over batches until input is exhausted
+ * 1. parses its slice of the batch into per shard buffers
+ * 2. stores the kmers buffered by all workers for the shard it owns
+ * workers are visited in order so read ids reach each kmer in increasing order
+ * a bin file is only written by the worker owning its mmers as the number of bins is a multiple of threads
+ * Arguments: pass ingest_worker
+ */
+void *ingest_worker_run(void *arg)
+{
+    ingest_worker *worker = arg;
+    ingest_state *state = worker->state;
+    int threads = state->threads;
+
+    while (true)
+    {
+        pthread_barrier_wait(&state->batch_read);
+        if (state->done)
+        {
+            break;
+        }
+
+        // parse contiguous slice of reads in the batch
+        int first = (long)state->read_count * worker->id / threads;
+        int last = (long)state->read_count * (worker->id + 1) / threads;
+        for (int i = first; i < last; i++)
+        {
+            extract_kmers(state->reads[i], state->read_lens[i], state->first_read_id + i, worker->sink, worker->sink_data);
+        }
+        pthread_barrier_wait(&state->batch_parsed);
+
+        // store kmers routed to this shard by every worker
+        for (int w = 0; w < threads; w++)
+        {
+            kmer_buffer *buffer = &state->buffers[w * threads + worker->id];
+            store_or_bin_records(state->shards[worker->id], buffered_records(buffer), buffer->count);
+            buffer->count = 0;
+        }
+        pthread_barrier_wait(&state->batch_stored);
+    }
+
+    return NULL;
+}
+
+/**
+ * Usage:
+ * reads all reads from file and stores their kmers using threads worker threads
+ * produces the same mmer hash table as calling process_read on every read
+ * Arguments:
+ * hash_table: mmer hash table
+ * file: read file
+ * threads: number of worker threads and shards
+ * sketch: if not NULL kmers are only counted in sketch and hash_table is left empty
+ */
+void ingest_reads_parallel(struct ZHashTable *hash_table, read_file *file, int threads, struct CSketch *sketch)
+{
+    ingest_state state;
+    ingest_worker *workers = malloc(threads * sizeof(ingest_worker));
+    pthread_t *thread_ids = malloc(threads * sizeof(pthread_t));
+
+    state.threads = threads;
+    state.reads = malloc(BATCH_READS * sizeof(char *));
+    state.read_lens = malloc(BATCH_READS * sizeof(int));
+    state.first_read_id = 0;
+    state.done = false;
+    state.buffers = calloc(threads * threads, sizeof(kmer_buffer));
+    state.shards = malloc(threads * sizeof(struct ZHashTable *));
+    pthread_barrier_init(&state.batch_read, NULL, threads + 1);
+    pthread_barrier_init(&state.batch_parsed, NULL, threads + 1);
+    pthread_barrier_init(&state.batch_stored, NULL, threads + 1);
+
+    for (int i = 0; i < threads; i++)
+    {
+        state.shards[i] = create_mmer_table();
+        workers[i].state = &state;
+        workers[i].id = i;
+        workers[i].sink = sketch != NULL ? count_kmer_sink : buffer_kmer_sink;
+        workers[i].sink_data = sketch != NULL ? (void *)sketch : &workers[i];
+        pthread_create(&thread_ids[i], NULL, ingest_worker_run, &workers[i]);
+    }
+
+    while (!state.done)
+    {
+        // read next batch while workers wait
+        state.read_count = 0;
+        // reads of the batch stay valid in the read file until they are released
+        release_reads(file);
+        while (state.read_count < BATCH_READS && next_read(file, &state.reads[state.read_count], &state.read_lens[state.read_count]))
+        {
+            state.read_count++;
+        }
+        state.done = state.read_count == 0;
+
+        pthread_barrier_wait(&state.batch_read);
+        if (!state.done)
+        {
+            pthread_barrier_wait(&state.batch_parsed);
+            pthread_barrier_wait(&state.batch_stored);
+            state.first_read_id += state.read_count;
+        }
+    }
+
+    // shards own disjoint mmers, move their kmer tables into hash_table
+    struct ZHashIterator iterator;
+    struct ZHashEntry **mmer_entry;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(thread_ids[i], NULL);
+        zhash_iterate_init(&iterator, state.shards[i]);
+        while ((mmer_entry = zhash_iterate(&iterator)) != NULL)
+        {
+            zhash_set_packed(hash_table, (*mmer_entry)->packed_key, (*mmer_entry)->val);
+        }
+        zfree_hash_table(state.shards[i]);
+    }
+
+    for (int i = 0; i < threads * threads; i++)
+    {
+        free(state.buffers[i].records);
+        free(state.buffers[i].runs);
+    }
+    pthread_barrier_destroy(&state.batch_read);
+    pthread_barrier_destroy(&state.batch_parsed);
+    pthread_barrier_destroy(&state.batch_stored);
+    free(state.buffers);
+    free(state.shards);
+    free(state.reads);
+    free(state.read_lens);
+    free(thread_ids);
+    free(workers);
+}
+
+/**
+ * Usage:
+ * first pass over the reads that counts every kmer into a sketch of sketch_bytes
+ * the file is opened again for the second pass, so it cannot be a pipe
+ * returns NULL if the file cannot be opened
+ * Arguments:
+ * path: read file
+ * sketch_bytes: memory used by the counters of the sketch
+ * threads: number of threads parsing reads
+ */
+struct CSketch *count_kmers(char *path, size_t sketch_bytes, int threads)
+{
+    read_file *file = open_read_file(path);
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    struct CSketch *sketch = ccreate_sketch(sketch_bytes, packed_words(kmer_size));
+    if (threads > 1)
+    {
+        ingest_reads_parallel(NULL, file, threads, sketch);
+    }
+    else
+    {
+        char *read;
+        int read_len;
+        while (next_read(file, &read, &read_len))
+        {
+            extract_kmers(read, read_len, 0, count_kmer_sink, sketch);
+            release_reads(file);
+        }
+    }
+    close_read_file(file);
+
+    return sketch;
+}
+
+/*****************************************
+ * Multi process ingestion
+ * Every rank reads all reads but only parses its slice of each batch, and sends every kmer
+ * to the rank owning its mmer, which is mmer % ranks so no rank needs to be told the owners
+ * Owners store and prune their kmers, rank 0 then gathers the survivors and extends them
+*****************************************/
+
+// buffers of kmers parsed by this rank, one for each owning rank
+typedef struct rank_ingest
+{
+    rank_comm *comm;
+    kmer_buffer *buffers;
+} rank_ingest;
+
+// kmer_sink that appends kmer to the buffer of the rank owning its mmer
+void rank_kmer_sink(void *sink_data, int mmer, const uint64_t *kmer, int read_id)
+{
+    rank_ingest *ingest = sink_data;
+    buffer_kmer(&ingest->buffers[mmer % ingest->comm->ranks], mmer, kmer, read_id);
+}
+
+/**
+ * Usage:
+ * stores the kmers owned by this rank from all reads of file, to be called by every rank
+ * kmers arrive from ranks in order of their slices so read ids reach each kmer in increasing order
+ * Arguments:
+ * hash_table: mmer hash table of this rank
+ * file: read file
+ * comm: ranks
+ */
+void ingest_reads_ranks(struct ZHashTable *hash_table, read_file *file, rank_comm *comm)
+{
+    int ranks = comm->ranks;
+    rank_ingest ingest = {comm, calloc(ranks, sizeof(kmer_buffer))};
+    char **send = malloc(ranks * sizeof(char *)), **recv = malloc(ranks * sizeof(char *));
+    size_t *send_lens = malloc(ranks * sizeof(size_t)), *recv_lens = malloc(ranks * sizeof(size_t));
+    char **reads = malloc(BATCH_READS * sizeof(char *));
+    int *read_lens = malloc(BATCH_READS * sizeof(int));
+    int read_count, first_read_id = 0;
+
+    // every rank sees the same batches, the last one is empty
+    do
+    {
+        read_count = 0;
+        release_reads(file);
+        while (read_count < BATCH_READS && next_read(file, &reads[read_count], &read_lens[read_count]))
+        {
+            read_count++;
+        }
+
+        int first = (long)read_count * comm->rank / ranks;
+        int last = (long)read_count * (comm->rank + 1) / ranks;
+        for (int i = first; i < last; i++)
+        {
+            extract_kmers(reads[i], read_lens[i], first_read_id + i, rank_kmer_sink, &ingest);
+        }
+
+        for (int r = 0; r < ranks; r++)
+        {
+            send[r] = buffered_records(&ingest.buffers[r]);
+            send_lens[r] = ingest.buffers[r].count * kmer_record_size();
+        }
+        exchange_messages(comm, send, send_lens, recv, recv_lens);
+
+        for (int r = 0; r < ranks; r++)
+        {
+            store_or_bin_records(hash_table, recv[r], recv_lens[r] / kmer_record_size());
+            free(recv[r]);
+            ingest.buffers[r].count = 0;
+        }
+        first_read_id += read_count;
+    } while (read_count > 0);
+
+    for (int r = 0; r < ranks; r++)
+    {
+        free(ingest.buffers[r].records);
+        free(ingest.buffers[r].runs);
+    }
+    free(ingest.buffers);
+    free(send);
+    free(recv);
+    free(send_lens);
+    free(recv_lens);
+    free(reads);
+    free(read_lens);
+}
+
+// kmer as sent to rank 0, followed by list_size bytes of its read id list
+typedef struct gathered_kmer
+{
+    uint64_t kmer[FHASH_MAX_KEY_WORDS];
+    int mmer;
+    int list_size;
+} gathered_kmer;
+
+/**
+ * Usage:
+ * sends the pruned kmers of every rank to rank 0, to be called by every rank
+ * rank 0 stores them in its hash table, the tables of other ranks are left as they are
+ * Arguments:
+ * hash_table: mmer hash table of this rank
+ * comm: ranks
+ */
+void gather_kmer_tables(struct ZHashTable *hash_table, rank_comm *comm)
+{
+    int ranks = comm->ranks;
+    char **send = calloc(ranks, sizeof(char *)), **recv = malloc(ranks * sizeof(char *));
+    size_t *send_lens = calloc(ranks, sizeof(size_t)), *recv_lens = malloc(ranks * sizeof(size_t));
+    struct ZHashIterator mmer_iterator;
+    struct ZHashEntry **mmer_entry;
+    struct FHashIterator iterator;
+    struct FHashSlot *slot;
+    gathered_kmer header;
+    read_id_list *read_ids;
+    size_t len = 0;
+
+    // size the message first so that it is allocated once
+    for (int pass = 0; pass < 2 && comm->rank != 0; pass++)
+    {
+        if (pass == 1)
+        {
+            send[0] = malloc(len);
+            send_lens[0] = len;
+            len = 0;
+        }
+
+        zhash_iterate_init(&mmer_iterator, hash_table);
+        while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+        {
+            fhash_iterate_init(&iterator, (*mmer_entry)->val);
+            while ((slot = fhash_iterate(&iterator)) != NULL)
+            {
+                read_ids = slot->val;
+                if (pass == 1)
+                {
+                    memset(&header, 0, sizeof(header));
+                    memcpy(header.kmer, slot->key, packed_words(kmer_size) * sizeof(uint64_t));
+                    header.mmer = (*mmer_entry)->packed_key;
+                    header.list_size = sizeof(read_id_list) + read_ids->size;
+                    memcpy(send[0] + len, &header, sizeof(header));
+                    memcpy(send[0] + len + sizeof(header), read_ids, header.list_size);
+                }
+                len += sizeof(header) + sizeof(read_id_list) + read_ids->size;
+            }
+        }
+    }
+
+    exchange_messages(comm, send, send_lens, recv, recv_lens);
+
+    // mmers of different ranks are disjoint
+    for (int r = 1; r < ranks && comm->rank == 0; r++)
+    {
+        for (size_t offset = 0; offset < recv_lens[r]; offset += sizeof(header) + header.list_size)
+        {
+            memcpy(&header, recv[r] + offset, sizeof(header));
+            read_ids = malloc(header.list_size);
+            memcpy(read_ids, recv[r] + offset + sizeof(header), header.list_size);
+            read_ids->capacity = read_ids->size;
+
+            struct FHashTable *kmer_storage;
+            if ((kmer_storage = zhash_get_packed(hash_table, header.mmer)) == NULL)
+            {
+                kmer_storage = fcreate_hash_table(packed_words(kmer_size));
+                zhash_set_packed(hash_table, header.mmer, kmer_storage);
+            }
+            fhash_set(kmer_storage, header.kmer, read_ids);
+        }
+    }
+
+    for (int r = 0; r < ranks; r++)
+    {
+        free(send[r]);
+        free(recv[r]);
+    }
+    free(send);
+    free(recv);
+    free(send_lens);
+    free(recv_lens);
+}
+
+/**
+ * Usage:
+ * delete kmers that don't occur in more than abundance_cutoff number of reads
+ * such kmers are highly likely to have been generated by errors
+ * returns NULL if all kmers in the hash table are freed
+ * Arguments: pass kmer hash table
+ */
+struct FHashTable *prune_kmers(struct FHashTable *hash_table)
+{
+    struct FHashIterator iterator;
+    struct FHashSlot *traverse;
+    read_id_list *read_ids;
+
+    fhash_iterate_init(&iterator, hash_table);
+    while ((traverse = fhash_iterate(&iterator)) != NULL)
+    {
+        read_ids = (read_id_list *)traverse->val;
+
+        // check if number of reads exceeds cutoff
+        if (read_ids->count <= abundance_cutoff)
+        {
+            // kmer has low occurence rate
+            // free list and remove entry
+            free_read_id_list(read_ids, NULL);
+            fhash_iterate_remove(&iterator);
+        }
+    }
+
+    // if entire hash table is emptied free and return NULL
+    if (hash_table->entry_count == 0)
+    {
+        ffree_hash_table(hash_table);
+        return NULL;
+    }
+    else
+    {
+        return hash_table;
+    }
+}
+
+/**
+ * Usage:
+ * delete all kmers that don't occur in more than abundance_cutoff number of reads
+ * Arguments: pass mmer hash table
+ */
+struct ZHashTable *prune_data(struct ZHashTable *hash_table)
+{
+    struct ZHashIterator iterator;
+    struct ZHashEntry **traverse;
+    zhash_iterate_init(&iterator, hash_table);
+    while ((traverse = zhash_iterate(&iterator)) != NULL)
+    {
+        // entries exist for this hash value
+        if (prune_kmers((*traverse)->val) == NULL)
+        {
+            // hash table has been emptied remove entry
+            // mark entry for removal
+            (*traverse)->val = NULL;
+            zhash_iterate_remove(&iterator);
+        }
+    }
+}
+
+/**
+ * Usage:
+ * sorts records by packed kmer with a least significant byte first radix sort
+ * the sort is stable, so records of equal kmers stay in increasing order of read ids
+ * bytes in which all records agree are skipped, most of them for small kmer_size
+ * returns records or spare, whichever holds the sorted records
+ * Arguments:
+ * records: records to sort
+ * spare: room for as many records
+ * count: number of records
+ */
+kmer_record *radix_sort_kmers(kmer_record *records, kmer_record *spare, size_t count)
+{
+    int key_bytes = (2 * kmer_size + 7) / 8;
+    if (count == 0)
+    {
+        return records;
+    }
+    size_t (*histograms)[256] = calloc(key_bytes, sizeof(*histograms));
+
+    // count every byte of every key in one pass
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int b = 0; b < key_bytes; b++)
+        {
+            histograms[b][records[i].kmer[b / 8] >> 8 * (b % 8) & 0xff]++;
+        }
+    }
+
+    for (int b = 0; b < key_bytes; b++)
+    {
+        size_t *histogram = histograms[b], offset = 0;
+        int byte = records[0].kmer[b / 8] >> 8 * (b % 8) & 0xff;
+        if (histogram[byte] == count)
+        {
+            continue;
         }
 
-        // get lexicographically next smallest mmer
-        // mmer score is incremented
-        mmer_score = next_smaller_mmer(mmer, mmer_score);
+        // histogram becomes the position of the first record with each byte
+        for (int v = 0; v < 256; v++)
+        {
+            size_t records_with_byte = histogram[v];
+            histogram[v] = offset;
+            offset += records_with_byte;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            spare[histogram[records[i].kmer[b / 8] >> 8 * (b % 8) & 0xff]++] = records[i];
+        }
+        SWAP(records, spare);
     }
-}
 
-/*****************************************
- * Debugger functions for printing information in mmer hash table
- * TODO: Add more functions to print more information
-*****************************************/
+    free(histograms);
+    return records;
+}
 
-// Usage: prints all mmers along with their kmers and reads ids
-// Arguments: pass mmer hash table
-void print_kmer_read_ids(struct ZHashTable *hash_table)
+/**
+ * Usage:
+ * counts the kmers of a bin by sorting them and stores every kmer occurring in more reads than abundance_cutoff
+ * equal kmers are adjacent after sorting, so each run of them is collapsed into a single entry
+ * with the read ids of the run, and kmers that would be pruned are never stored
+ * a kmer always has the same signature, so the mmer of the first record of a run is the mmer of all of them
+ * Arguments:
+ * hash_table: mmer hash table
+ * records: kmers of the bin in increasing order of read ids, reordered
+ * spare: room for as many records
+ * count: number of records
+ */
+void count_sorted_kmers(struct ZHashTable *hash_table, kmer_record *records, kmer_record *spare, size_t count)
 {
-    struct ZHashTable *kmer_hash;
-    struct ZHashEntry *mmer_entry, *kmer_entry;
-    ll_node *read_id, *traverse;
+    int *read_ids = NULL, capacity = 0;
+    size_t start, end;
 
-    while ((mmer_entry = (struct ZHashEntry *)iterate_level_one_hash(hash_table, false, false)) != NULL)
+    records = radix_sort_kmers(records, spare, count);
+    for (start = 0; start < count; start = end)
     {
-        kmer_hash = (mmer_entry)->val;
-        printf("%s\n", mmer_entry->key); // print mmer
-        // iterate over all kmers of mmer
-        while ((kmer_entry = (struct ZHashEntry *)iterate_level_two_hash(kmer_hash, false, false)) != NULL)
+        for (end = start + 1; end < count && memcmp(records[end].kmer, records[start].kmer, sizeof(records[start].kmer)) == 0; end++)
         {
-            printf("%s\n", kmer_entry->key);
-            read_id = (ll_node *)kmer_entry->val;
-            // iterate over read id lists of each base pair
-            while (read_id != NULL)
-            {
-                traverse = (ll_node *)read_id->item;
-                // print each read id of base pair in same line
-                while (traverse != NULL)
-                {
-                    printf("%d ", traverse->read_id);
-                    traverse = traverse->next;
-                }
-                printf("\n");
-                read_id = read_id->next;
-            }
         }
-        printf("\n");
+
+        int occurrences = end - start;
+        if (occurrences <= abundance_cutoff)
+        {
+            continue;
+        }
+
+        if (occurrences > capacity)
+        {
+            capacity = MAX(2 * capacity, occurrences);
+            read_ids = realloc(read_ids, capacity * sizeof(int));
+        }
+        for (int i = 0; i < occurrences; i++)
+        {
+            read_ids[i] = records[start + i].read_id;
+        }
+
+        struct FHashTable *kmer_storage;
+        if ((kmer_storage = zhash_get_packed(hash_table, records[start].mmer)) == NULL)
+        {
+            kmer_storage = fcreate_hash_table(packed_words(kmer_size));
+            zhash_set_packed(hash_table, records[start].mmer, kmer_storage);
+        }
+        fhash_set(kmer_storage, records[start].kmer, create_read_id_list_of(read_ids, occurrences));
     }
+
+    free(read_ids);
 }
 
-// Usage: prints all kmers
-// Arguments: pass mmer hash table
-void print_kmers(struct ZHashTable *hash_table)
+/**
+ * Usage:
+ * loads every record of bin, split into kmers, and counts them with count_sorted_kmers
+ * Arguments:
+ * hash_table: mmer hash table
+ * bin: bin of kmer_bins
+ */
+void load_sorted_bin(struct ZHashTable *hash_table, int bin)
 {
-    struct ZHashTable *kmer_hash;
-    struct ZHashEntry *mmer_entry, *kmer_entry;
-    ll_node *read_id, *traverse;
+    char *chunk = malloc(BIN_CHUNK * kmer_record_size());
+    kmer_record *records = NULL;
+    size_t count = 0, capacity = 0, chunk_count;
 
-    // iterate over all mmers in hash table
-    while ((mmer_entry = (struct ZHashEntry *)iterate_level_one_hash(hash_table, false, false)) != NULL)
+    rewind_bin(kmer_bins, bin);
+    while ((chunk_count = read_bin_records(kmer_bins, bin, chunk, BIN_CHUNK)) > 0)
     {
-        kmer_hash = (mmer_entry)->val;
-        // iterate over all kmers of mmer
-        while ((kmer_entry = (struct ZHashEntry *)iterate_level_two_hash(kmer_hash, false, false)) != NULL)
+        for (size_t i = 0; i < chunk_count; i++)
         {
-            printf("%s\n", kmer_entry->key);
+            superkmer_record *run = &((superkmer_record *)chunk)[i];
+            int kmers = super_kmers ? run->kmers : 1;
+            if (count + kmers > capacity)
+            {
+                capacity = MAX(2 * capacity, count + kmers + BIN_CHUNK);
+                records = realloc(records, capacity * sizeof(kmer_record));
+            }
+
+            if (!super_kmers)
+            {
+                records[count++] = ((kmer_record *)chunk)[i];
+                continue;
+            }
+            for (int k = 0; k < kmers; k++)
+            {
+                superkmer_kmer(run, k, records[count].kmer);
+                records[count].mmer = run->mmer;
+                records[count].read_id = run->read_id;
+                count++;
+            }
         }
     }
-}
+    close_bin(kmer_bins, bin);
+    free(chunk);
 
-/*****************************************
- * Process reads to populate kmer and mmer hash table
- * Perform pruning and deletion of low abundance kmers
-*****************************************/
+    kmer_record *spare = malloc(MAX(count, (size_t)1) * sizeof(kmer_record));
+    count_sorted_kmers(hash_table, records, spare, count);
+    free(records);
+    free(spare);
+}
 
 /**
  * Usage:
- * duplicate read id list for each base pair
- * to be called after pruning so that only abundant kmers have read ids expanded
- * Arguments:
- * pass mmer hash table
+ * loads the kmers written to kmer_bins one bin at a time and stores the ones surviving pruning
+ * only the kmers of a single bin have to be held before they are pruned
+ * super-kmers are split into their kmers as they are stored
+ * Arguments: pass mmer hash table
  */
-void expand_read_id_list(struct ZHashTable *hashtable)
+void load_binned_kmers(struct ZHashTable *hash_table)
 {
-    struct ZHashEntry *mmer_entry = NULL, *kmer_entry = NULL;
-    struct ZHashTable *kmer_hash = NULL;
-    ll_node *read_id_list, *traverse = NULL;
-    ll_node *read_id_lists;
-    int kmer_len, i;
-    while ((mmer_entry = iterate_level_one_hash(hashtable, false, false)) != NULL)
+    char *records = malloc(BIN_CHUNK * kmer_record_size());
+    struct ZHashIterator iterator;
+    struct ZHashEntry **mmer_entry;
+    size_t count;
+
+    for (int bin = 0; bin < kmer_bins->count; bin++)
     {
-        kmer_hash = mmer_entry->val;
-        while ((kmer_entry = iterate_level_two_hash(kmer_hash, false, false)) != NULL)
+        if (sort_counting)
+        {
+            load_sorted_bin(hash_table, bin);
+            continue;
+        }
+
+        // records were written in increasing order of read ids
+        struct ZHashTable *bin_table = create_mmer_table();
+        rewind_bin(kmer_bins, bin);
+        while ((count = read_bin_records(kmer_bins, bin, records, BIN_CHUNK)) > 0)
         {
-            traverse = NULL;
-            read_id_list = kmer_entry->val;
-            kmer_len = strlen(kmer_entry->key);
-            for (i = 0; i < kmer_len; i++)
+            for (size_t i = 0; i < count; i++)
             {
-                if (traverse == NULL)
+                if (super_kmers)
                 {
-                    traverse = create_node_item(read_id_list);
-                    read_id_lists = traverse;
+                    store_superkmer(bin_table, &((superkmer_record *)records)[i]);
                 }
                 else
                 {
-                    traverse->next = create_node_item(duplicate_llist(read_id_list));
-                    traverse = traverse->next;
+                    kmer_record *record = &((kmer_record *)records)[i];
+                    store_kmer(bin_table, record->mmer, record->kmer, record->read_id);
                 }
             }
-            kmer_entry->val = read_id_lists;
         }
+        close_bin(kmer_bins, bin);
+
+        // bins hold disjoint mmers, move their kmer tables into hash_table
+        prune_data(bin_table);
+        zhash_iterate_init(&iterator, bin_table);
+        while ((mmer_entry = zhash_iterate(&iterator)) != NULL)
+        {
+            zhash_set_packed(hash_table, (*mmer_entry)->packed_key, (*mmer_entry)->val);
+        }
+        zfree_hash_table(bin_table);
     }
+
+    free(records);
 }
 
 /**
  * Usage:
- * stores all kmers of a read
- * kmers are stored in 2 level hashing
- * first level is hashed by signature of kmer i.e. a mmer
- * second level is hashed by kmer itself
- * lexically smaller of kmer and its reverse complement is stored
+ * writes the pruned kmer tables to a snapshot at path that load_kmer_snapshot can start from
+ * to be called after pruning while kmer tables are packed
+ * returns false if path cannot be created
  * Arguments:
  * hash_table: mmer hash table
- * read: read from which kmers are be parsed and stored
- * read_id: for debugging purposes
+ * path: file to write
  */
-struct ZHashTable *process_read(struct ZHashTable *hash_table, char *read, int read_id)
+bool write_kmer_snapshot(struct ZHashTable *hash_table, const char *path)
 {
-    int read_len = strlen(read);
-    char *kmer = read;
-    char *signature = NULL;
-    int i, j;
-
-    // initialize local variables for extracting signature
-    char kmer_key[KMER_SIZE + 1];
-    char mmer[MMER_SIZE + 1];
-    char signature_cpy[MMER_SIZE + 1];
-    int score, rev_score, max_score;
-    bool is_rev;
-    int msb;
-
-    // slide a window of KMER_SIZE over read
-    for (i = 0; i < read_len - KMER_SIZE + 1; i++)
+    snapshot_header params = {.kmer_size = kmer_size, .mmer_size = mmer_size, .key_words = packed_words(kmer_size), .random_order = random_order, .abundance_cutoff = abundance_cutoff};
+    snapshot_writer *writer = create_snapshot(path, &params);
+    struct ZHashIterator mmer_iterator;
+    struct ZHashEntry **mmer_entry;
+    struct FHashIterator iterator;
+    struct FHashSlot *kmer_slot;
+
+    if (writer == NULL)
     {
+        return false;
+    }
 
-        // iterate over the read and calculate the signature from scratch
-        if (kmer > signature)
+    zhash_iterate_init(&mmer_iterator, hash_table);
+    while ((mmer_entry = zhash_iterate(&mmer_iterator)) != NULL)
+    {
+        struct FHashTable *kmer_hash = (*mmer_entry)->val;
+        write_snapshot_bucket(writer, (*mmer_entry)->packed_key, kmer_hash->entry_count);
+        fhash_iterate_init(&iterator, kmer_hash);
+        while ((kmer_slot = fhash_iterate(&iterator)) != NULL)
         {
+            write_snapshot_kmer(writer, kmer_slot->key, kmer_slot->val);
+        }
+    }
 
-            // re intialize values each time for fresh calculation
-            score = 0;
-            rev_score = 0;
-            max_score = 0;
+    close_snapshot(writer);
+    return true;
+}
 
-            // store first MMER_SIZE characters in array
-            for (j = 0; j < MMER_SIZE; j++)
-            {
-                mmer[j] = kmer[j];
-                score = score * 4 + getval(kmer[j]);
-                rev_score = rev_score * 4 + 3 - getval(kmer[j]);
-            }
-            mmer[MMER_SIZE] = '\0';
+/**
+ * Usage:
+ * loads kmer tables from a snapshot written by write_kmer_snapshot instead of ingesting reads
+ * kmer_size, mmer_size and the mmer order are taken from the snapshot
+ * the snapshot stays mapped as kmer_snapshot and read id lists are used from it without copying
+ * kmers in no more reads than abundance_cutoff are skipped, so a snapshot can be pruned further
+ * a cutoff that was left out is the one the snapshot was pruned with
+ * a lower one ends the program, the kmers it would keep are gone
+ * kmer tables are sized for their bucket up front, so loading allocates once per mmer
+ * returns NULL if path cannot be opened
+ * Arguments:
+ * path: snapshot file
+ * cutoff_given: true if abundance_cutoff was set by -c
+ */
+struct ZHashTable *load_kmer_snapshot(const char *path, bool cutoff_given)
+{
+    const uint64_t *key;
+    read_id_list *read_ids;
+    int mmer, kmer_count;
 
-            // initialize max score
-            if (score > rev_score)
-            {
-                max_score = score;
-                is_rev = false;
-            }
-            else
-            {
-                max_score = rev_score;
-                is_rev = true;
-            }
-            signature = kmer;
-            msb = 0;
+    if ((kmer_snapshot = map_snapshot(path)) == NULL)
+    {
+        return NULL;
+    }
 
-            // iterate over other characters
-            j = MMER_SIZE;
-            while (j < KMER_SIZE)
-            {
-                // incrementally update scores
-                score = (score - getval(mmer[msb]) * power_val[MMER_SIZE - 1]) * 4;
-                score += getval(kmer[j]);
-                rev_score = (rev_score - ((3 - getval(mmer[msb])) * power_val[MMER_SIZE - 1])) * 4;
-                rev_score += 3 - getval(kmer[j]);
-
-                // rotate msb of mmer
-                mmer[msb] = kmer[j];
-                msb = (msb + 1) % MMER_SIZE;
-
-                // increment pointer to next char
-                j++;
-
-                // change max score if required
-                // set boolean if rev complement of mmer is signature
-                if (MAX(score, rev_score) > max_score)
-                {
-                    if (score > rev_score)
-                    {
-                        max_score = score;
-                        is_rev = false;
-                    }
-                    else
-                    {
-                        max_score = rev_score;
-                        is_rev = true;
-                    }
+    snapshot_header *header = &kmer_snapshot->header;
+    if (header->mmer_size < 1 || header->mmer_size > MAX_MMER_SIZE || header->kmer_size <= header->mmer_size || header->kmer_size > MAX_KMER_SIZE || header->key_words != packed_words(header->kmer_size))
+    {
+        fprintf(stderr, "malformed snapshot: %s has invalid kmer or mmer size\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (!cutoff_given)
+    {
+        abundance_cutoff = header->abundance_cutoff;
+    }
+    else if (abundance_cutoff < header->abundance_cutoff)
+    {
+        fprintf(stderr, "%s was pruned with cutoff %d, -c cannot be lower\n", path, header->abundance_cutoff);
+        exit(EXIT_FAILURE);
+    }
+    kmer_size = header->kmer_size;
+    mmer_size = header->mmer_size;
+    random_order = header->random_order;
 
-                    // set new signature to point MMER_SIZE behind the next char to be added
-                    signature = &kmer[j] - MMER_SIZE;
-                }
-            }
+    struct ZHashTable *hash_table = create_mmer_table();
+    while (next_snapshot_bucket(kmer_snapshot, &mmer, &kmer_count))
+    {
+        if (mmer < 0 || mmer >= 1 << 2 * mmer_size)
+        {
+            fprintf(stderr, "malformed snapshot: %s has a bucket with an invalid mmer\n", path);
+            exit(EXIT_FAILURE);
         }
-        // No need for calculating signature from scratch
-        // check if new signatures are smaller than previous signature
-        else
+
+        struct FHashTable *kmer_storage = NULL;
+        for (int i = 0; i < kmer_count; i++)
         {
-            // compare current signature with new mmer
-            // new mmer is created by last letter added to the current kmer
-            // store last MMER_SIZE characters of kmer in mmer array
-            for (j = KMER_SIZE - MMER_SIZE; j < MMER_SIZE; j++)
+            next_snapshot_kmer(kmer_snapshot, &key, &read_ids);
+            if (read_ids->count <= abundance_cutoff)
             {
-                mmer[j] = kmer[j];
-                score = score * 4 + getval(kmer[j]);
-                rev_score = rev_score * 4 + 3 - getval(kmer[j]);
+                continue;
             }
-            mmer[MMER_SIZE] = '\0';
 
-            if (MAX(score, rev_score) > max_score)
+            if (kmer_storage == NULL)
             {
-                if (score > rev_score)
+                kmer_storage = fcreate_hash_table(header->key_words);
+                size_t size = kmer_storage->size;
+                while ((size_t)kmer_count * 4 > size * 3)
                 {
-                    max_score = score;
-                    is_rev = false;
+                    size *= 2;
                 }
-                else
+                if (size > kmer_storage->size)
                 {
-                    max_score = rev_score;
-                    is_rev = true;
+                    fhash_rehash(kmer_storage, size);
                 }
-
-                // set signature as newly calculated mmer
-                signature = &kmer[KMER_SIZE - MMER_SIZE];
+                zhash_set_packed(hash_table, mmer, kmer_storage);
             }
+            fhash_set(kmer_storage, key, read_ids);
         }
+    }
 
-        strncpy(signature_cpy, signature, MMER_SIZE);
-        strncpy(kmer_key, kmer, KMER_SIZE);
-        signature_cpy[MMER_SIZE] = '\0';
-        kmer_key[KMER_SIZE] = '\0';
+    return hash_table;
+}
 
-        // get reverse complement of signature if rev complement has higher score
-        if (is_rev)
+// pass file name containing reads
+// -t sets number of threads used for ingesting reads and, with -g, for building unitigs
+// -k, -m and -c set kmer size, mmer size and abundance cutoff
+// -s counts kmers in a first pass using a sketch of the given megabytes, kmers it shows to be pruned are not stored
+// -d writes kmers to bin files in the given directory and prunes one bin at a time
+// -r splits ingestion and pruning over the given number of processes, threads are then only used with -g
+// -g builds unitigs by compacting the de Bruijn graph of all kmers instead of mmer ordered extension
+// -o picks the order of mmers for signatures, lex for dictionary order or random to spread kmers evenly
+// -b prints a histogram of kmers per mmer bucket after pruning to stderr
+// -x passes runs of kmers sharing a signature between threads, ranks and bin files as super-kmers
+// -q counts the kmers of each bin by radix sorting them instead of storing them one at a time, needs -d
+// -w writes the pruned kmers to the given snapshot file before extension
+// -l reads the kmers from a snapshot file written by -w instead of reads, kmer and mmer size, order and cutoff come from it
+//    -k, -m and -o given with -l must match the snapshot and -c can only be raised
+int main(int argc, char *argv[])
+{
+    int threads = 1, ranks = 1;
+    int opt;
+    size_t sketch_mb = 0;
+    char *bin_dir = NULL;
+    char *snapshot_path = NULL;
+    bool compact_graph = false, bucket_histogram = false, valid_order = true, from_snapshot = false;
+    // -k, -m, -o and -c as given, 0 and -1 when left out
+    int given_kmer_size = 0, given_mmer_size = 0, given_order = -1, given_cutoff = -1;
+    while ((opt = getopt(argc, argv, "t:k:m:c:s:d:r:go:bxqw:l")) != -1)
+    {
+        switch (opt)
         {
-            for (j = 0; j < MMER_SIZE; j++)
-            {
-                signature_cpy[j] = getbp(3 - getval(signature_cpy[j]));
-            }
+        case 't':
+            threads = atoi(optarg);
+            break;
 
-            for (j = 0; j < KMER_SIZE; j++)
-            {
-                kmer_key[j] = getbp(3 - getval(kmer_key[j]));
-            }
+        case 'k':
+            kmer_size = given_kmer_size = atoi(optarg);
+            break;
+
+        case 'm':
+            mmer_size = given_mmer_size = atoi(optarg);
+            break;
+
+        case 'c':
+            abundance_cutoff = given_cutoff = atoi(optarg);
+            break;
+
+        case 's':
+            sketch_mb = strtoul(optarg, NULL, 10);
+            break;
+
+        case 'd':
+            bin_dir = optarg;
+            break;
+
+        case 'r':
+            ranks = atoi(optarg);
+            break;
+
+        case 'g':
+            compact_graph = true;
+            break;
+
+        case 'o':
+            random_order = strcmp(optarg, "random") == 0;
+            valid_order = random_order || strcmp(optarg, "lex") == 0;
+            given_order = random_order;
+            break;
+
+        case 'b':
+            bucket_histogram = true;
+            break;
+
+        case 'x':
+            super_kmers = true;
+            break;
+
+        case 'q':
+            sort_counting = true;
+            break;
+
+        case 'w':
+            snapshot_path = optarg;
+            break;
+
+        case 'l':
+            from_snapshot = true;
+            break;
+
+        default:
+            threads = 0;
         }
+    }
 
-        // check if this mmer has been stored before
-        // if not create a new hash table to store kmers for this signature
-        struct ZHashTable *kmer_storage;
-        if ((kmer_storage = zhash_get(hash_table, signature_cpy)) == NULL)
+    // mmer must leave at least one base pair of the kmer to extend by
+    bool valid_sizes = mmer_size >= 1 && mmer_size <= MAX_MMER_SIZE && kmer_size > mmer_size && kmer_size <= MAX_KMER_SIZE;
+    // counts of a sketch would have to be summed over all ranks
+    bool valid_ranks = ranks >= 1 && (ranks == 1 || sketch_mb == 0);
+    bool valid_counting = !sort_counting || bin_dir != NULL;
+    bool valid_snapshot = !from_snapshot || (ranks == 1 && sketch_mb == 0 && bin_dir == NULL);
+    if (threads < 1 || !valid_sizes || !valid_ranks || !valid_order || !valid_counting || !valid_snapshot || abundance_cutoff < 0 || optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-k kmer_size] [-m mmer_size] [-c abundance_cutoff] [-s sketch_mb] [-d bin_dir] [-r ranks] [-g] [-o lex|random] [-b] [-x] [-q] [-w snapshot_file] [-l] reads_file|snapshot_file\n", argv[0]);
+        fprintf(stderr, "mmer_size must be 1 to %d and kmer_size above mmer_size up to %d, -s cannot be used with -r, -q needs -d, -l cannot be used with -s, -d or -r\n", MAX_MMER_SIZE, MAX_KMER_SIZE);
+        return EXIT_FAILURE;
+    }
+    select_kmer_extractor();
+
+    // a snapshot starts straight from pruned kmers
+    struct ZHashTable *hash_table;
+    if (from_snapshot)
+    {
+        if ((hash_table = load_kmer_snapshot(argv[optind], given_cutoff >= 0)) == NULL)
+        {
+            perror(argv[optind]);
+            return EXIT_FAILURE;
+        }
+        if ((given_kmer_size && given_kmer_size != kmer_size) || (given_mmer_size && given_mmer_size != mmer_size) || (given_order >= 0 && given_order != random_order))
+        {
+            fprintf(stderr, "usage: %s -l snapshot_file\n", argv[0]);
+            fprintf(stderr, "%s has kmer_size %d, mmer_size %d and %s order, -k, -m and -o must match them or be left out\n", argv[optind], kmer_size, mmer_size, random_order ? "random" : "lex");
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        // every rank opens the input on its own, so like a first pass it cannot read a pipe
+        struct stat input_stat;
+        if ((sketch_mb > 0 || ranks > 1) && stat(argv[optind], &input_stat) == 0 && !S_ISREG(input_stat.st_mode))
         {
-            kmer_storage = zcreate_hash_table();
-            zhash_set(hash_table, signature_cpy, kmer_storage);
+            fprintf(stderr, "%s: -s and -r need a regular file that can be read more than once\n", argv[optind]);
+            return EXIT_FAILURE;
         }
 
-        // check if this kmer has been stored previously
-        ll_node *read_id_list, *traverse;
-        if ((read_id_list = zhash_get(kmer_storage, kmer_key)) == NULL)
+        rank_comm *comm = NULL;
+        if (ranks > 1 && (comm = spawn_ranks(ranks)) == NULL)
         {
-            // create entry for the first time
-            traverse = (ll_node *)create_node_num(read_id);
-            zhash_set(kmer_storage, kmer_key, traverse);
+            perror("could not create ranks");
+            return EXIT_FAILURE;
         }
-        else
+
+        // count kmers before any is stored
+        if (sketch_mb > 0 && (kmer_sketch = count_kmers(argv[optind], sketch_mb << 20, threads)) == NULL)
         {
-            // to make operation efficient and maintain descending order sorted linked list
-            // shift read id of first node to second node and and put new read id in first node
-            // all other nodes are untouched and there is no need to store the linked list again
-            // as the pointer to first node has not changed
-            traverse = (ll_node *)create_node_num(read_id_list->read_id);
-            read_id_list->read_id = read_id;
-            traverse->next = read_id_list->next;
-            read_id_list->next = traverse;
+            perror(argv[optind]);
+            return EXIT_FAILURE;
         }
 
-        // increment kmer pointer
-        kmer++;
-    }
+        // initialize file and structures
+        // reads can be one per line, FASTA or FASTQ and optionally gzip compressed
+        read_file *file = open_read_file(argv[optind]);
+        if (file == NULL)
+        {
+            perror(argv[optind]);
+            return EXIT_FAILURE;
+        }
+        hash_table = create_mmer_table();
 
-    return hash_table;
-}
+        // every shard of parallel ingestion needs bins of its own
+        if (bin_dir != NULL)
+        {
+            int bins = (BIN_FILES + threads - 1) / threads * threads;
+            if ((kmer_bins = create_bin_files(bin_dir, bins, kmer_record_size())) == NULL)
+            {
+                perror(bin_dir);
+                return EXIT_FAILURE;
+            }
+        }
 
-/**
- * Usage:
- * delete kmers that don't occur in more than ABUNDANCE_CUTOFF number of reads
- * such kmers are highly likely to have been generated by errors
- * returns NULL if all kmers in the hash table are freed
- * Arguments: pass kmer hash table
- */
-struct ZHashTable *prune_kmers(struct ZHashTable *hash_table)
-{
-    struct ZHashEntry **traverse, **to_remove = NULL;
-    struct ZHashEntry *temp;
-    ll_node *read_id_list, *temp_node;
-    while ((traverse = iterate_level_two_hash(hash_table, true, false)) != NULL)
-    {
+        if (comm != NULL)
+        {
+            ingest_reads_ranks(hash_table, file, comm);
+        }
+        else if (threads > 1)
+        {
+            ingest_reads_parallel(hash_table, file, threads, NULL);
+        }
+        else
+        {
+            // initialize variables
+            char *read;
+            int read_len, read_id = 0;
 
-        read_id_list = (ll_node *)(*traverse)->val;
-        int count = 1;
-        // check if number of reads exceeds cutoff
-        while (read_id_list->next != NULL && count <= ABUNDANCE_CUTOFF)
+            // get all the reads from file, each read points into the file without being copied
+            while (next_read(file, &read, &read_len))
+            {
+                process_read(hash_table, read, read_len, read_id++);
+                release_reads(file);
+            }
+        }
+        close_read_file(file);
+        if (kmer_sketch != NULL)
         {
-            count++;
-            read_id_list = read_id_list->next;
+            cfree_sketch(kmer_sketch);
+            kmer_sketch = NULL;
         }
 
-        if (count <= ABUNDANCE_CUTOFF)
+        // prune stored values and remove possibly erroneous kmers
+        if (kmer_bins != NULL)
         {
-            // kmer has low occurence rate
-            // free node and remove entry
-            free((*traverse)->val);
-            (*traverse)->val = NULL;
-            // mark current node for removal
-            iterate_level_two_hash(NULL, false, true);
+            load_binned_kmers(hash_table);
+            free_bin_files(kmer_bins);
+            kmer_bins = NULL;
+        }
+        else
+        {
+            prune_data(hash_table);
         }
-    }
 
-    // if entire hash table is emptied free and return NULL
-    if (hash_table->entry_count == 0)
+        // only rank 0 goes on to extension
+        if (comm != NULL)
+        {
+            gather_kmer_tables(hash_table, comm);
+            bool rank_zero = comm->rank == 0;
+            if (!finish_ranks(comm) || !rank_zero)
+            {
+                return rank_zero ? EXIT_FAILURE : EXIT_SUCCESS;
+            }
+        }
+    }
+    if (bucket_histogram)
     {
-        free(hash_table);
-        return NULL;
+        print_bucket_histogram(hash_table);
     }
-    else
+    if (snapshot_path != NULL && !write_kmer_snapshot(hash_table, snapshot_path))
     {
-        return hash_table;
+        perror(snapshot_path);
+        return EXIT_FAILURE;
     }
-}
 
-/**
- * Usage:
- * delete all kmers that don't occur in more than ABUNDANCE_CUTOFF number of reads
- * Arguments: pass mmer hash table
- */
-struct ZHashTable *prune_data(struct ZHashTable *hash_table)
-{
-    struct ZHashEntry **traverse, *temp;
-    while ((traverse = iterate_level_one_hash(hash_table, true, false)) != NULL)
+    // store kmers as strings so they can grow into unitigs
+    // everything allocated for them from here on comes from one arena
+    extension_arena = zcreate_arena();
+    zhash_set_arena(extension_arena);
+    unpack_kmer_tables(hash_table);
+    // expand remaining entries
+    expand_read_id_list(hash_table);
+    if (kmer_snapshot != NULL)
     {
-        // entries exist for this hash value
-        if (prune_kmers((*traverse)->val) == NULL)
-        {
-            // hash table has been emptied remove entry
-            // mark entry for removal
-            (*traverse)->val = NULL;
-            iterate_level_one_hash(NULL, false, true);
-        }
+        unmap_snapshot(kmer_snapshot);
+        kmer_snapshot = NULL;
     }
-}
-
-// pass file name containing reads
-int main(int argc, char *argv[])
-{
-    // initialize file and structures
-    FILE *file = fopen(argv[1], "r");
-    struct ZHashTable *hash_table = zcreate_hash_table();
-
-    // initialize variables
-    char read[READ_LENGTH];
-    int read_id = 0;
 
-    // get all the reads from file
-    while (fgets(read, READ_LENGTH, file) != NULL)
+    if (compact_graph)
     {
-
-        // pre process and store read
-        int len = strlen(read);
-        read[--len] = '\0';
-
-        process_read(hash_table, read, read_id++);
+        compact_kmer_graph(hash_table, threads);
+    }
+    else
+    {
+        create_end_index();
+        index_entries(hash_table);
+
+        // apply unitig extension to the data
+        // first left to right directions
+        // then in right to left direction
+        find_kmer_extensions(hash_table, true);
+        find_kmer_extensions(hash_table, false);
+        free_end_index();
     }
-
-    // prune stored values and remove possibly erroneous kmers
-    prune_data(hash_table);
-    // expand remaining entries
-    expand_read_id_list(hash_table);
-
-    // apply unitig extension to the data
-    // first left to right directions
-    // then in right to left direction
-    find_kmer_extensions(hash_table, true);
-    find_kmer_extensions(hash_table, false);
 
     // print kmers
     print_kmers(hash_table);
+
+    // release keys, entries and read ids of all unitigs at once
+    zhash_set_arena(NULL);
+    zfree_arena(extension_arena);
 }
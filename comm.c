@@ -0,0 +1,225 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "comm.h"
+
+// bytes of the length sent ahead of every message
+#define HEADER_SIZE sizeof(uint64_t)
+
+static void comm_failure(const char* message) {
+    perror(message);
+    exit(EXIT_FAILURE);
+}
+
+// closes every socket opened so far, pairs of i and j > i are opened in order up to opened
+static void free_pairs(rank_comm* comm, int* pairs, int opened) {
+    int ranks = comm->ranks;
+
+    for (int k = 0; k < opened; k++) {
+        int i = k / ranks, j = k % ranks;
+        if (j > i) {
+            close(pairs[i * ranks + j]);
+            close(pairs[j * ranks + i]);
+        }
+    }
+    free(pairs);
+    free(comm->sockets);
+    free(comm->children);
+    free(comm);
+}
+
+/**
+ * forks ranks - 1 processes connected to each other and to this one by socket pairs
+ * this process becomes rank 0, every process closes the sockets between other ranks
+ */
+rank_comm* spawn_ranks(int ranks) {
+    rank_comm* comm = malloc(sizeof(rank_comm));
+    int* pairs = malloc(ranks * ranks * sizeof(int));
+    pid_t pid;
+
+    comm->rank = 0;
+    comm->ranks = ranks;
+    comm->sockets = malloc(ranks * sizeof(int));
+    comm->children = calloc(ranks, sizeof(pid_t));
+
+    // pairs[i * ranks + j] is the end of the socket between i and j kept by i
+    for (int i = 0; i < ranks; i++) {
+        pairs[i * ranks + i] = -1;
+        for (int j = i + 1; j < ranks; j++) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+                free_pairs(comm, pairs, i * ranks + j);
+                return NULL;
+            }
+            pairs[i * ranks + j] = fds[0];
+            pairs[j * ranks + i] = fds[1];
+        }
+    }
+
+    for (int i = 1; i < ranks; i++) {
+        if ((pid = fork()) < 0) {
+            // ranks forked so far see their sockets close and fail on their first exchange
+            free_pairs(comm, pairs, ranks * ranks);
+            return NULL;
+        }
+        if (pid == 0) {
+            comm->rank = i;
+            break;
+        }
+        comm->children[i] = pid;
+    }
+
+    for (int i = 0; i < ranks; i++) {
+        for (int j = 0; j < ranks; j++) {
+            if (i == comm->rank) {
+                comm->sockets[j] = pairs[i * ranks + j];
+            } else if (j != i) {
+                close(pairs[i * ranks + j]);
+            }
+        }
+    }
+
+    // exchanges poll all sockets at once so no rank blocks on a full socket
+    for (int i = 0; i < ranks; i++) {
+        if (comm->sockets[i] >= 0) {
+            fcntl(comm->sockets[i], F_SETFL, fcntl(comm->sockets[i], F_GETFL) | O_NONBLOCK);
+        }
+    }
+
+    free(pairs);
+    return comm;
+}
+
+/**
+ * closes all sockets of this rank
+ * rank 0 waits for the other ranks to exit
+ * returns false if any of them failed
+ */
+bool finish_ranks(rank_comm* comm) {
+    bool success = true;
+    int status;
+
+    for (int i = 0; i < comm->ranks; i++) {
+        if (comm->sockets[i] >= 0) {
+            close(comm->sockets[i]);
+        }
+    }
+
+    for (int i = 1; i < comm->ranks; i++) {
+        if (comm->children[i] > 0) {
+            if (waitpid(comm->children[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                success = false;
+            }
+        }
+    }
+
+    free(comm->sockets);
+    free(comm->children);
+    free(comm);
+    return success;
+}
+
+/**
+ * sends outgoing[i] of outgoing_lens[i] bytes to every rank i and receives the message of rank i in incoming[i]
+ * all ranks must call it together, the message to this rank is copied
+ * received messages are allocated with malloc and owned by the caller
+ */
+void exchange_messages(rank_comm* comm, char** outgoing, size_t* outgoing_lens, char** incoming, size_t* incoming_lens) {
+    int ranks = comm->ranks;
+    uint64_t* send_headers = malloc(ranks * sizeof(uint64_t));
+    uint64_t* recv_headers = malloc(ranks * sizeof(uint64_t));
+    size_t* sent = calloc(ranks, sizeof(size_t));
+    size_t* received = calloc(ranks, sizeof(size_t));
+    struct pollfd* polls = malloc(ranks * sizeof(struct pollfd));
+    int pending = 2 * (ranks - 1);
+    ssize_t count;
+
+    incoming_lens[comm->rank] = outgoing_lens[comm->rank];
+    incoming[comm->rank] = malloc(outgoing_lens[comm->rank] + 1);
+    if (outgoing_lens[comm->rank] > 0) {
+        memcpy(incoming[comm->rank], outgoing[comm->rank], outgoing_lens[comm->rank]);
+    }
+
+    for (int i = 0; i < ranks; i++) {
+        send_headers[i] = outgoing_lens[i];
+    }
+
+    while (pending > 0) {
+        // a message is done once its header and all its bytes are through
+        for (int i = 0; i < ranks; i++) {
+            polls[i].fd = i == comm->rank ? -1 : comm->sockets[i];
+            polls[i].events = 0;
+            if (i != comm->rank && sent[i] < HEADER_SIZE + outgoing_lens[i]) {
+                polls[i].events |= POLLOUT;
+            }
+            if (i != comm->rank && (received[i] < HEADER_SIZE || received[i] < HEADER_SIZE + recv_headers[i])) {
+                polls[i].events |= POLLIN;
+            }
+            // a finished peer may exit, its hangup would wake every poll
+            if (polls[i].events == 0) {
+                polls[i].fd = -1;
+            }
+        }
+
+        if (poll(polls, ranks, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            comm_failure("could not wait for ranks");
+        }
+
+        for (int i = 0; i < ranks; i++) {
+            if (polls[i].fd < 0 || polls[i].revents == 0) {
+                continue;
+            }
+
+            if ((polls[i].events & POLLOUT) && (polls[i].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                if (sent[i] < HEADER_SIZE) {
+                    count = send(polls[i].fd, (char*)&send_headers[i] + sent[i], HEADER_SIZE - sent[i], MSG_NOSIGNAL);
+                } else {
+                    count = send(polls[i].fd, outgoing[i] + sent[i] - HEADER_SIZE, outgoing_lens[i] - (sent[i] - HEADER_SIZE), MSG_NOSIGNAL);
+                }
+                if (count < 0 && errno != EAGAIN && errno != EINTR) {
+                    comm_failure("could not send to rank");
+                }
+                if (count > 0 && (sent[i] += count) == HEADER_SIZE + outgoing_lens[i]) {
+                    pending--;
+                }
+            }
+
+            if ((polls[i].events & POLLIN) && (polls[i].revents & (POLLIN | POLLERR | POLLHUP))) {
+                if (received[i] < HEADER_SIZE) {
+                    count = recv(polls[i].fd, (char*)&recv_headers[i] + received[i], HEADER_SIZE - received[i], 0);
+                } else {
+                    count = recv(polls[i].fd, incoming[i] + received[i] - HEADER_SIZE, recv_headers[i] - (received[i] - HEADER_SIZE), 0);
+                }
+                if (count == 0 || (count < 0 && errno != EAGAIN && errno != EINTR)) {
+                    fprintf(stderr, "rank %d lost connection to rank %d\n", comm->rank, i);
+                    exit(EXIT_FAILURE);
+                }
+                if (count > 0 && (received[i] += count) == HEADER_SIZE) {
+                    incoming_lens[i] = recv_headers[i];
+                    incoming[i] = malloc(incoming_lens[i] + 1);
+                }
+                if (count > 0 && received[i] == HEADER_SIZE + recv_headers[i]) {
+                    pending--;
+                }
+            }
+        }
+    }
+
+    free(send_headers);
+    free(recv_headers);
+    free(sent);
+    free(received);
+    free(polls);
+}
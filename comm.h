@@ -0,0 +1,25 @@
+#ifndef COMM_H
+#define COMM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// processes working on one assembly, each identified by its rank
+// every pair of ranks is connected by a local socket
+typedef struct rank_comm {
+    int rank;               // rank of this process, 0 is the process that spawned the others
+    int ranks;              // number of ranks
+    int* sockets;           // socket connected to each rank, -1 for this rank
+    pid_t* children;        // process of each rank, only kept by rank 0
+} rank_comm;
+
+// rank creation and destruction
+// spawn_ranks returns in every rank, NULL if the ranks cannot be created
+rank_comm* spawn_ranks(int ranks);
+bool finish_ranks(rank_comm* comm);
+
+// communication
+void exchange_messages(rank_comm* comm, char** outgoing, size_t* outgoing_lens, char** incoming, size_t* incoming_lens);
+
+#endif
@@ -0,0 +1,100 @@
+#include "./encode.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ENCODE_X86
+#endif
+
+// helper functions
+static void encode_scalar(const char *bases, int len, uint8_t *codes);
+
+// kernel selected for the cpu when the program starts
+static void (*encode_kernel)(const char *bases, int len, uint8_t *codes) = encode_scalar;
+
+const uint8_t base_codes[256] = {
+  [0 ... 'A' - 1] = BASE_INVALID,
+  ['A'] = 3, ['B'] = BASE_INVALID, ['C'] = 2, ['D' ... 'F'] = BASE_INVALID,
+  ['G'] = 1, ['H' ... 'S'] = BASE_INVALID, ['T'] = 0, ['U' ... 'a' - 1] = BASE_INVALID,
+  ['a'] = 3, ['b'] = BASE_INVALID, ['c'] = 2, ['d' ... 'f'] = BASE_INVALID,
+  ['g'] = 1, ['h' ... 's'] = BASE_INVALID, ['t'] = 0, ['u' ... 255] = BASE_INVALID
+};
+
+void encode_bases(const char *bases, int len, uint8_t *codes)
+{
+  encode_kernel(bases, len, codes);
+}
+
+static void encode_scalar(const char *bases, int len, uint8_t *codes)
+{
+  int ii;
+
+  for (ii = 0; ii < len; ii++) {
+    codes[ii] = base_codes[(unsigned char)bases[ii]];
+  }
+}
+
+#ifdef ENCODE_X86
+
+// A, C, G and T differ in their low nibble (1, 3, 7 and 4), which indexes two shuffle tables:
+// one holds the code of the base pair, the other the uppercase character the nibble belongs to
+// clearing bit 5 uppercases a letter, a character is valid if it then matches the table
+#define CODE_TABLE 4, 3, 4, 2, 0, 4, 4, 1, 4, 4, 4, 4, 4, 4, 4, 4
+#define CHAR_TABLE 0, 'A', 0, 'C', 'T', 0, 0, 'G', 0, 0, 0, 0, 0, 0, 0, 0
+
+__attribute__((target("ssse3")))
+static void encode_ssse3(const char *bases, int len, uint8_t *codes)
+{
+  const __m128i code_table = _mm_setr_epi8(CODE_TABLE);
+  const __m128i char_table = _mm_setr_epi8(CHAR_TABLE);
+  const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+  const __m128i case_mask = _mm_set1_epi8((char)0xdf);
+  const __m128i invalid = _mm_set1_epi8(BASE_INVALID);
+  __m128i chars, nibbles, code, valid;
+  int ii;
+
+  for (ii = 0; ii + 16 <= len; ii += 16) {
+    chars = _mm_loadu_si128((const __m128i *)(bases + ii));
+    nibbles = _mm_and_si128(chars, nibble_mask);
+    code = _mm_shuffle_epi8(code_table, nibbles);
+    valid = _mm_cmpeq_epi8(_mm_and_si128(chars, case_mask), _mm_shuffle_epi8(char_table, nibbles));
+    code = _mm_or_si128(_mm_and_si128(valid, code), _mm_andnot_si128(valid, invalid));
+    _mm_storeu_si128((__m128i *)(codes + ii), code);
+  }
+
+  encode_scalar(bases + ii, len - ii, codes + ii);
+}
+
+__attribute__((target("avx2")))
+static void encode_avx2(const char *bases, int len, uint8_t *codes)
+{
+  // shuffles work within each 128 bit lane so both lanes hold the tables
+  const __m256i code_table = _mm256_setr_epi8(CODE_TABLE, CODE_TABLE);
+  const __m256i char_table = _mm256_setr_epi8(CHAR_TABLE, CHAR_TABLE);
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i case_mask = _mm256_set1_epi8((char)0xdf);
+  const __m256i invalid = _mm256_set1_epi8(BASE_INVALID);
+  __m256i chars, nibbles, code, valid;
+  int ii;
+
+  for (ii = 0; ii + 32 <= len; ii += 32) {
+    chars = _mm256_loadu_si256((const __m256i *)(bases + ii));
+    nibbles = _mm256_and_si256(chars, nibble_mask);
+    code = _mm256_shuffle_epi8(code_table, nibbles);
+    valid = _mm256_cmpeq_epi8(_mm256_and_si256(chars, case_mask), _mm256_shuffle_epi8(char_table, nibbles));
+    code = _mm256_blendv_epi8(invalid, code, valid);
+    _mm256_storeu_si256((__m256i *)(codes + ii), code);
+  }
+
+  encode_ssse3(bases + ii, len - ii, codes + ii);
+}
+
+__attribute__((constructor))
+static void select_kernel(void)
+{
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) encode_kernel = encode_avx2;
+  else if (__builtin_cpu_supports("ssse3")) encode_kernel = encode_ssse3;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef ENCODE_H
+#define ENCODE_H
+
+#include <stdint.h>
+
+// 2-bit codes of base pairs: A = 3, C = 2, G = 1, T = 0
+// flipping both bits of a code gives the code of its complement
+// lowercase base pairs have the same codes as uppercase ones
+
+// code of any character that is not a base pair, such as N
+#define BASE_INVALID 4
+
+// code of every ASCII character
+extern const uint8_t base_codes[256];
+
+// writes the code of each of the len characters of bases to codes
+// uses the widest vector instructions supported by the cpu
+void encode_bases(const char *bases, int len, uint8_t *codes);
+
+#endif
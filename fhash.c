@@ -0,0 +1,299 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./fhash.h"
+
+// number of slots in a new table, must be a power of two
+#define INITIAL_SIZE 16
+// distances are stored in a byte, a longer probe grows the table instead
+#define MAX_DISTANCE UINT8_MAX
+
+// helper functions
+static struct FHashSlot *slot_at(struct FHashTable *hash_table, size_t index);
+static bool key_equal(struct FHashTable *hash_table, const uint64_t *a, const uint64_t *b);
+static size_t find_slot(struct FHashTable *hash_table, const uint64_t *key);
+static void insert_entry(struct FHashTable *hash_table, const uint64_t *key, void *val);
+static void remove_slot(struct FHashTable *hash_table, size_t index);
+static void *fmalloc(size_t size);
+static void *fcalloc(size_t num, size_t size);
+
+// key_words is the number of 64 bit words in each key, at most FHASH_MAX_KEY_WORDS
+struct FHashTable *fcreate_hash_table(int key_words)
+{
+  struct FHashTable *hash_table;
+
+  hash_table = fmalloc(sizeof(struct FHashTable));
+
+  hash_table->size = INITIAL_SIZE;
+  hash_table->entry_count = 0;
+  hash_table->key_words = key_words;
+  hash_table->slot_size = sizeof(struct FHashSlot) + key_words * sizeof(uint64_t);
+  hash_table->slots = fmalloc(INITIAL_SIZE * hash_table->slot_size);
+  hash_table->distances = fcalloc(INITIAL_SIZE, sizeof(uint8_t));
+
+  return hash_table;
+}
+
+void ffree_hash_table(struct FHashTable *hash_table)
+{
+  free(hash_table->slots);
+  free(hash_table->distances);
+  free(hash_table);
+}
+
+void fhash_set(struct FHashTable *hash_table, const uint64_t *key, void *val)
+{
+  size_t index;
+
+  if ((index = find_slot(hash_table, key)) != hash_table->size) {
+    slot_at(hash_table, index)->val = val;
+    return;
+  }
+
+  // keep the load factor under 3/4 so that probe sequences stay short
+  if ((hash_table->entry_count + 1) * 4 > hash_table->size * 3) {
+    fhash_rehash(hash_table, hash_table->size * 2);
+  }
+
+  insert_entry(hash_table, key, val);
+  hash_table->entry_count++;
+}
+
+void *fhash_get(struct FHashTable *hash_table, const uint64_t *key)
+{
+  size_t index;
+
+  index = find_slot(hash_table, key);
+
+  return index != hash_table->size ? slot_at(hash_table, index)->val : NULL;
+}
+
+void *fhash_delete(struct FHashTable *hash_table, const uint64_t *key)
+{
+  size_t index;
+  void *val;
+
+  if ((index = find_slot(hash_table, key)) == hash_table->size) return NULL;
+
+  val = slot_at(hash_table, index)->val;
+  remove_slot(hash_table, index);
+
+  return val;
+}
+
+bool fhash_exists(struct FHashTable *hash_table, const uint64_t *key)
+{
+  return find_slot(hash_table, key) != hash_table->size;
+}
+
+// iteration starts after an empty slot
+// backward shifting on removal never moves an entry across an empty slot
+// so entries that are not yet visited stay ahead of the cursor
+void fhash_iterate_init(struct FHashIterator *iterator, struct FHashTable *hash_table)
+{
+  iterator->table = hash_table;
+  iterator->start = 0;
+  iterator->step = 0;
+  iterator->removed = false;
+
+  while (hash_table->distances[iterator->start]) iterator->start++;
+}
+
+struct FHashSlot *fhash_iterate(struct FHashIterator *iterator)
+{
+  struct FHashTable *hash_table;
+  size_t index;
+
+  hash_table = iterator->table;
+
+  // removal shifted the next entry into the current slot, visit it again
+  if (iterator->removed) iterator->removed = false;
+  else iterator->step++;
+
+  while (iterator->step < hash_table->size) {
+    index = (iterator->start + iterator->step) & (hash_table->size - 1);
+
+    if (hash_table->distances[index]) return slot_at(hash_table, index);
+
+    iterator->step++;
+  }
+
+  return NULL;
+}
+
+// removes the entry last returned by fhash_iterate
+// its slot must not be used afterwards
+void fhash_iterate_remove(struct FHashIterator *iterator)
+{
+  struct FHashTable *hash_table;
+
+  hash_table = iterator->table;
+
+  remove_slot(hash_table, (iterator->start + iterator->step) & (hash_table->size - 1));
+  iterator->removed = true;
+}
+
+// mixes all bits of the packed key (murmur3 finalizer), size is a power of two
+// further words are mixed in before the lowest one is
+size_t fgenerate_hash(struct FHashTable *hash_table, const uint64_t *key)
+{
+  uint64_t hash;
+  int ii;
+
+  hash = 0;
+  for (ii = hash_table->key_words - 1; ii >= 0; ii--) {
+    hash ^= key[ii];
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+  }
+
+  return hash & (hash_table->size - 1);
+}
+
+void fhash_rehash(struct FHashTable *hash_table, size_t size)
+{
+  size_t old_size, ii;
+  struct FHashSlot *slot;
+  char *slots;
+  uint8_t *distances;
+
+  old_size = hash_table->size;
+  slots = hash_table->slots;
+  distances = hash_table->distances;
+
+  hash_table->size = size;
+  hash_table->slots = fmalloc(size * hash_table->slot_size);
+  hash_table->distances = fcalloc(size, sizeof(uint8_t));
+
+  for (ii = 0; ii < old_size; ii++) {
+    slot = (struct FHashSlot *)(slots + ii * hash_table->slot_size);
+    if (distances[ii]) insert_entry(hash_table, slot->key, slot->val);
+  }
+
+  free(slots);
+  free(distances);
+}
+
+static struct FHashSlot *slot_at(struct FHashTable *hash_table, size_t index)
+{
+  return (struct FHashSlot *)(hash_table->slots + index * hash_table->slot_size);
+}
+
+static bool key_equal(struct FHashTable *hash_table, const uint64_t *a, const uint64_t *b)
+{
+  int ii;
+
+  for (ii = 0; ii < hash_table->key_words; ii++) {
+    if (a[ii] != b[ii]) return false;
+  }
+
+  return true;
+}
+
+// returns index of the slot holding key or size of the table if key is absent
+static size_t find_slot(struct FHashTable *hash_table, const uint64_t *key)
+{
+  size_t mask, index;
+  unsigned distance;
+
+  mask = hash_table->size - 1;
+  index = fgenerate_hash(hash_table, key);
+
+  // an entry closer to its home than the probe means key is absent
+  for (distance = 1; hash_table->distances[index] >= distance; distance++) {
+    if (key_equal(hash_table, slot_at(hash_table, index)->key, key)) return index;
+
+    index = (index + 1) & mask;
+  }
+
+  return hash_table->size;
+}
+
+// places entry without checking for an existing key or updating entry_count
+static void insert_entry(struct FHashTable *hash_table, const uint64_t *key, void *val)
+{
+  size_t mask, index, slot_size;
+  unsigned distance;
+  uint8_t temp_distance;
+  uint64_t slot_buffer[1 + FHASH_MAX_KEY_WORDS], temp_buffer[1 + FHASH_MAX_KEY_WORDS];
+  struct FHashSlot *slot, *temp;
+
+  // the carried entry lives outside the table while it is swapped along
+  slot_size = hash_table->slot_size;
+  slot = (struct FHashSlot *)slot_buffer;
+  temp = (struct FHashSlot *)temp_buffer;
+  memcpy(slot->key, key, hash_table->key_words * sizeof(uint64_t));
+  slot->val = val;
+
+  mask = hash_table->size - 1;
+  index = fgenerate_hash(hash_table, key);
+  distance = 1;
+
+  while (hash_table->distances[index]) {
+    // robin hood: the entry further away from its home keeps the slot
+    if (hash_table->distances[index] < distance) {
+      memcpy(temp, slot_at(hash_table, index), slot_size);
+      temp_distance = hash_table->distances[index];
+      memcpy(slot_at(hash_table, index), slot, slot_size);
+      hash_table->distances[index] = distance;
+      memcpy(slot, temp, slot_size);
+      distance = temp_distance;
+    }
+
+    index = (index + 1) & mask;
+
+    // the carried entry restarts its probe in the grown table
+    if (++distance == MAX_DISTANCE) {
+      fhash_rehash(hash_table, hash_table->size * 2);
+      mask = hash_table->size - 1;
+      index = fgenerate_hash(hash_table, slot->key);
+      distance = 1;
+    }
+  }
+
+  memcpy(slot_at(hash_table, index), slot, slot_size);
+  hash_table->distances[index] = distance;
+}
+
+// removes entry at index by shifting the rest of its cluster one slot back
+static void remove_slot(struct FHashTable *hash_table, size_t index)
+{
+  size_t mask, next;
+
+  mask = hash_table->size - 1;
+  next = (index + 1) & mask;
+
+  while (hash_table->distances[next] > 1) {
+    memcpy(slot_at(hash_table, index), slot_at(hash_table, next), hash_table->slot_size);
+    hash_table->distances[index] = hash_table->distances[next] - 1;
+    index = next;
+    next = (next + 1) & mask;
+  }
+
+  hash_table->distances[index] = 0;
+  hash_table->entry_count--;
+}
+
+static void *fmalloc(size_t size)
+{
+  void *ptr;
+
+  ptr = malloc(size);
+
+  if (!ptr) exit(EXIT_FAILURE);
+
+  return ptr;
+}
+
+static void *fcalloc(size_t num, size_t size)
+{
+  void *ptr;
+
+  ptr = calloc(num, size);
+
+  if (!ptr) exit(EXIT_FAILURE);
+
+  return ptr;
+}
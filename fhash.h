@@ -0,0 +1,64 @@
+#ifndef FHASH_H
+#define FHASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// flat open addressing hash table
+// keys are 2-bit packed kmers of one or more 64 bit words stored inline, lowest word first
+// values are void *pointers
+// robin hood linear probing over a power of two number of slots
+
+// longest key in words, enough for kmers of 64 base pairs
+#define FHASH_MAX_KEY_WORDS 2
+
+// struct representing a slot in the hash table
+// key has the number of words of its table
+struct FHashSlot {
+  void *val;
+  uint64_t key[];
+};
+
+// struct representing the hash table
+// slots are slot_size bytes apart, which depends on the number of key words
+// distances holds probe distance + 1 of the entry in each slot, 0 marks an empty slot
+// the table grows when needed but never shrinks on deletion
+struct FHashTable {
+  size_t size;
+  size_t entry_count;
+  int key_words;
+  size_t slot_size;
+  char *slots;
+  uint8_t *distances;
+};
+
+// cursor for iterating a table, owned by the caller
+// the current entry can be removed with fhash_iterate_remove
+struct FHashIterator {
+  struct FHashTable *table;
+  size_t start;
+  size_t step;
+  bool removed;
+};
+
+// hash table creation and destruction
+struct FHashTable *fcreate_hash_table(int key_words);
+void ffree_hash_table(struct FHashTable *hash_table);
+
+// hash operations
+void fhash_set(struct FHashTable *hash_table, const uint64_t *key, void *val);
+void *fhash_get(struct FHashTable *hash_table, const uint64_t *key);
+void *fhash_delete(struct FHashTable *hash_table, const uint64_t *key);
+bool fhash_exists(struct FHashTable *hash_table, const uint64_t *key);
+
+// iteration
+void fhash_iterate_init(struct FHashIterator *iterator, struct FHashTable *hash_table);
+struct FHashSlot *fhash_iterate(struct FHashIterator *iterator);
+void fhash_iterate_remove(struct FHashIterator *iterator);
+
+// other functions
+size_t fgenerate_hash(struct FHashTable *hash_table, const uint64_t *key);
+void fhash_rehash(struct FHashTable *hash_table, size_t size);
+
+#endif
@@ -0,0 +1,276 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "idlist.h"
+
+// bytes needed to encode one delta of a read id
+#define MAX_VARINT_SIZE 5
+
+static read_id_list* allocate_list(int capacity, struct ZArena* arena) {
+    read_id_list* list = zarena_alloc(arena, sizeof(read_id_list) + capacity);
+    list->count = 0;
+    list->last = 0;
+    list->size = 0;
+    list->capacity = capacity;
+    return list;
+}
+
+// appends read_id to list that has space for it
+static void encode_read_id(read_id_list* list, int read_id) {
+    unsigned int delta = read_id - list->last;
+
+    // 7 bits per byte, high bit set when more bytes follow
+    while (delta >= 0x80) {
+        list->bytes[list->size++] = (delta & 0x7f) | 0x80;
+        delta >>= 7;
+    }
+    list->bytes[list->size++] = delta;
+
+    list->last = read_id;
+    list->count++;
+}
+
+read_id_list* create_read_id_list(int read_id) {
+    read_id_list* list = allocate_list(MAX_VARINT_SIZE, NULL);
+    encode_read_id(list, read_id);
+    return list;
+}
+
+// read_ids must be in increasing order, list is sized to hold exactly them
+read_id_list* create_read_id_list_of(const int* read_ids, int count) {
+    read_id_list* list;
+    unsigned int delta;
+    int size = 0, last = 0;
+
+    for (int i = 0; i < count; i++) {
+        for (delta = read_ids[i] - last; delta >= 0x80; delta >>= 7) {
+            size++;
+        }
+        size++;
+        last = read_ids[i];
+    }
+
+    list = allocate_list(size, NULL);
+    for (int i = 0; i < count; i++) {
+        encode_read_id(list, read_ids[i]);
+    }
+    return list;
+}
+
+// copy has no spare capacity and must not be appended to
+read_id_list* duplicate_read_id_list(read_id_list* list, struct ZArena* arena) {
+    read_id_list* new_list = allocate_list(list->size, arena);
+    memcpy(new_list, list, sizeof(read_id_list) + list->size);
+    new_list->capacity = list->size;
+    return new_list;
+}
+
+// read_id must not be smaller than the last id of list
+// list must have been created by create_read_id_list
+// returns list which may have been moved to grow it
+read_id_list* append_read_id(read_id_list* list, int read_id) {
+    if (list->size + MAX_VARINT_SIZE > list->capacity) {
+        list->capacity = list->capacity * 2 + MAX_VARINT_SIZE;
+        list = realloc(list, sizeof(read_id_list) + list->capacity);
+    }
+
+    encode_read_id(list, read_id);
+    return list;
+}
+
+// iterates ids of list in increasing order
+// start with *offset and *read_id set to 0, returns false when all ids have been returned
+bool next_read_id(read_id_list* list, int* offset, int* read_id) {
+    unsigned int delta = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    if (*offset == list->size) {
+        return false;
+    }
+
+    do {
+        byte = list->bytes[(*offset)++];
+        delta |= (unsigned int)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    *read_id += delta;
+    return true;
+}
+
+// returns new sorted merge of a and b, ids present in both are kept once
+read_id_list* merge_read_id_lists(read_id_list* a, read_id_list* b, struct ZArena* arena) {
+    // a merged id is never further from its predecessor than in its own list
+    // so the merged encoding fits in the space of both lists
+    read_id_list* merged = allocate_list(a->size + b->size, arena);
+    int a_offset = 0, b_offset = 0, a_id = 0, b_id = 0;
+    bool a_left = next_read_id(a, &a_offset, &a_id);
+    bool b_left = next_read_id(b, &b_offset, &b_id);
+
+    while (a_left && b_left) {
+        if (a_id < b_id) {
+            encode_read_id(merged, a_id);
+            a_left = next_read_id(a, &a_offset, &a_id);
+        } else if (a_id > b_id) {
+            encode_read_id(merged, b_id);
+            b_left = next_read_id(b, &b_offset, &b_id);
+        } else {
+            // equality case keep one of the ids
+            encode_read_id(merged, a_id);
+            a_left = next_read_id(a, &a_offset, &a_id);
+            b_left = next_read_id(b, &b_offset, &b_id);
+        }
+    }
+
+    // if any list is not exhausted append to merged
+    while (a_left) {
+        encode_read_id(merged, a_id);
+        a_left = next_read_id(a, &a_offset, &a_id);
+    }
+
+    while (b_left) {
+        encode_read_id(merged, b_id);
+        b_left = next_read_id(b, &b_offset, &b_id);
+    }
+
+    return merged;
+}
+
+bool equal_read_id_lists(read_id_list* a, read_id_list* b) {
+    // same ids give the same encoding
+    return a->count == b->count && a->size == b->size && memcmp(a->bytes, b->bytes, a->size) == 0;
+}
+
+void free_read_id_list(read_id_list* list, struct ZArena* arena) {
+    zarena_free(arena, list, sizeof(read_id_list) + list->capacity);
+}
+
+read_id_run* create_read_id_run(int length, read_id_list* ids, struct ZArena* arena) {
+    read_id_run* run = zarena_alloc(arena, sizeof(read_id_run));
+    run->length = length;
+    run->ids = ids;
+    run->next = NULL;
+    return run;
+}
+
+// frees run along with its ids, does not free the runs after it
+void free_read_id_run(read_id_run* run, struct ZArena* arena) {
+    free_read_id_list(run->ids, arena);
+    zarena_free(arena, run, sizeof(read_id_run));
+}
+
+// spans of a kmer whose runs start at its first base
+read_id_spans* create_read_id_spans(read_id_run* runs, struct ZArena* arena) {
+    read_id_spans* spans = zarena_alloc(arena, sizeof(read_id_spans));
+    read_id_span* span = zarena_alloc(arena, sizeof(read_id_span));
+    span->offset = 0;
+    span->runs = runs;
+    span->next = NULL;
+
+    spans->count = 1;
+    spans->shift = 0;
+    spans->head = spans->tail = span;
+    return spans;
+}
+
+// returns spans of the unitig where right starts right_offset bases after the start of left
+// the side with fewer spans is rebased onto the other and both headers are consumed
+read_id_spans* join_read_id_spans(read_id_spans* left, read_id_spans* right, int right_offset, struct ZArena* arena) {
+    read_id_spans* kept = left->count >= right->count ? left : right;
+    read_id_spans* moved = kept == left ? right : left;
+
+    // bases of the unitig are counted from the start of left
+    if (kept == right) {
+        kept->shift += right_offset;
+    }
+
+    int delta = moved->shift + (moved == right ? right_offset : 0) - kept->shift;
+    for (read_id_span* span = moved->head; span != NULL; span = span->next) {
+        span->offset += delta;
+    }
+
+    // every span of left starts before every span of right
+    if (kept == left) {
+        kept->tail->next = moved->head;
+        kept->tail = moved->tail;
+    } else {
+        moved->tail->next = kept->head;
+        kept->head = moved->head;
+    }
+    kept->count += moved->count;
+
+    zarena_free(arena, moved, sizeof(read_id_spans));
+    return kept;
+}
+
+// run of a span that covers the current base and the base after its end
+typedef struct span_cursor {
+    read_id_run* run;
+    int end;
+} span_cursor;
+
+// returns new runs with the ids of every span covering each of the length bases of the unitig
+// neighbouring bases with equal ids share a run, spans are left unchanged
+read_id_run* materialize_read_id_spans(read_id_spans* spans, int length, struct ZArena* arena) {
+    read_id_run *first = NULL, *last = NULL;
+    read_id_span* span = spans->head;
+    span_cursor* active = NULL;
+    int active_count = 0, active_capacity = 0;
+
+    for (int pos = 0, next; pos < length; pos = next) {
+        // start runs of spans beginning at this base
+        while (span != NULL && span->offset + spans->shift <= pos) {
+            if (active_count == active_capacity) {
+                active_capacity = active_capacity * 2 + 16;
+                active = realloc(active, active_capacity * sizeof(span_cursor));
+            }
+            active[active_count].run = span->runs;
+            active[active_count++].end = span->offset + spans->shift + span->runs->length;
+            span = span->next;
+        }
+
+        // ids only change where a run ends or a span starts
+        next = span != NULL ? span->offset + spans->shift : length;
+        read_id_list* ids = NULL;
+        for (int i = 0; i < active_count; i++) {
+            next = active[i].end < next ? active[i].end : next;
+            if (ids == NULL) {
+                ids = duplicate_read_id_list(active[i].run->ids, arena);
+            } else {
+                read_id_list* merged = merge_read_id_lists(ids, active[i].run->ids, arena);
+                free_read_id_list(ids, arena);
+                ids = merged;
+            }
+        }
+
+        if (last != NULL && equal_read_id_lists(last->ids, ids)) {
+            last->length += next - pos;
+            free_read_id_list(ids, arena);
+        } else {
+            read_id_run* run = create_read_id_run(next - pos, ids, arena);
+            if (last == NULL) {
+                first = run;
+            } else {
+                last->next = run;
+            }
+            last = run;
+        }
+
+        // move past runs that end here, spans whose runs are exhausted are dropped
+        for (int i = 0; i < active_count;) {
+            if (active[i].end == next && (active[i].run = active[i].run->next) != NULL) {
+                active[i].end += active[i].run->length;
+            }
+            if (active[i].run == NULL) {
+                active[i] = active[--active_count];
+            } else {
+                i++;
+            }
+        }
+    }
+
+    free(active);
+    return first;
+}
@@ -0,0 +1,67 @@
+#ifndef IDLIST_H
+#define IDLIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "arena.h"
+
+// compact list of read ids in increasing order
+// each id is stored as the varint encoded difference from the previous id
+typedef struct read_id_list {
+    int count;      // number of ids in list
+    int last;       // largest id, the next appended id is encoded relative to it
+    int size;       // bytes of encoded ids
+    int capacity;   // bytes allocated for encoded ids
+    uint8_t bytes[];
+} read_id_list;
+
+// run of consecutive bases of a kmer that are covered by the same reads
+// runs of a kmer are linked in order of their bases and each owns its ids
+typedef struct read_id_run {
+    int length;
+    read_id_list* ids;
+    struct read_id_run* next;
+} read_id_run;
+
+// kmer whose runs cover bases of a unitig from offset on
+// offset is relative to the shift of the spans it belongs to
+typedef struct read_id_span {
+    int offset;
+    read_id_run* runs;
+    struct read_id_span* next;
+} read_id_span;
+
+// read ids of a unitig kept as the runs of the kmers it was merged from
+// joining spans of two unitigs takes time in the number of spans of the smaller one
+// ids of overlapping kmers are only merged per base by materialize_read_id_spans
+typedef struct read_id_spans {
+    int count;          // number of spans
+    int shift;          // added to the offset of every span to give its base in the unitig
+    read_id_span* head; // spans in order of offset
+    read_id_span* tail;
+} read_id_spans;
+
+// list creator functions
+// lists that are appended to are allocated with malloc, others come from the arena passed
+read_id_list* create_read_id_list(int read_id);
+read_id_list* create_read_id_list_of(const int* read_ids, int count);
+read_id_list* duplicate_read_id_list(read_id_list* list, struct ZArena* arena);
+
+// list operations
+read_id_list* append_read_id(read_id_list* list, int read_id);
+bool next_read_id(read_id_list* list, int* offset, int* read_id);
+read_id_list* merge_read_id_lists(read_id_list* a, read_id_list* b, struct ZArena* arena);
+bool equal_read_id_lists(read_id_list* a, read_id_list* b);
+void free_read_id_list(read_id_list* list, struct ZArena* arena);
+
+// run functions
+read_id_run* create_read_id_run(int length, read_id_list* ids, struct ZArena* arena);
+void free_read_id_run(read_id_run* run, struct ZArena* arena);
+
+// span functions
+read_id_spans* create_read_id_spans(read_id_run* runs, struct ZArena* arena);
+read_id_spans* join_read_id_spans(read_id_spans* left, read_id_spans* right, int right_offset, struct ZArena* arena);
+read_id_run* materialize_read_id_spans(read_id_spans* spans, int length, struct ZArena* arena);
+
+#endif
@@ -0,0 +1,312 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "readfile.h"
+
+// bytes read from a stream at a time, blocks grow to hold longer records
+#define BLOCK_SIZE (4 << 20)
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+static void bad_input(const char* message) {
+    fprintf(stderr, "malformed read file: %s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+// reads more input into the current block
+// room is made by moving the unparsed tail to the start of a block
+// a block still holding unreleased reads is retired instead of being overwritten
+static void fill_block(read_file* file) {
+    size_t tail = file->size - file->pos;
+    size_t capacity;
+    char* data;
+    int count;
+
+    // mapped files are complete from the start
+    if (file->eof) {
+        return;
+    }
+
+    if (file->capacity - file->size < BLOCK_SIZE / 2) {
+        // grow when a single record takes up most of the block
+        capacity = MAX(file->capacity, 2 * tail + BLOCK_SIZE);
+
+        if (file->kept < file->pos) {
+            retired_block* block = malloc(sizeof(retired_block));
+            block->data = file->data;
+            block->next = file->retired;
+            file->retired = block;
+
+            data = malloc(capacity);
+            memcpy(data, file->data + file->pos, tail);
+            file->data = data;
+        } else {
+            memmove(file->data, file->data + file->pos, tail);
+            if (capacity > file->capacity) {
+                file->data = realloc(file->data, capacity);
+            }
+        }
+
+        file->capacity = capacity;
+        file->size = tail;
+        file->pos = 0;
+        file->kept = 0;
+    }
+
+    count = gzread(file->stream, file->data + file->size, MIN(file->capacity - file->size, INT_MAX));
+    if (count < 0) {
+        bad_input("could not decompress input");
+    }
+
+    file->eof = count == 0;
+    file->size += count;
+}
+
+// finds end of line starting at offset, returns false if more input is needed
+// last line of input does not need a newline
+static bool find_line_end(read_file* file, size_t offset, size_t* end) {
+    char* newline = memchr(file->data + offset, '\n', file->size - offset);
+
+    if (newline != NULL) {
+        *end = newline - file->data;
+        return true;
+    }
+
+    if (file->eof) {
+        *end = file->size;
+        return true;
+    }
+
+    return false;
+}
+
+// returns start of the line after the line ending at end
+static size_t next_line(read_file* file, size_t end) {
+    return end < file->size ? end + 1 : end;
+}
+
+// drops carriage return of windows line endings
+static size_t trim_line(read_file* file, size_t start, size_t end) {
+    return end > start && file->data[end - 1] == '\r' ? end - 1 : end;
+}
+
+/**
+ * finds the sequence of the record at pos
+ * sequence lines of a FASTA record are joined in place
+ * returns 1 if a record is found, 0 if more input is needed and -1 at end of input
+ */
+static int parse_record(read_file* file, size_t* start, size_t* end, size_t* next) {
+    size_t pos = file->pos, line, line_end, write;
+
+    // skip blank lines between records
+    while (pos < file->size && isspace((unsigned char)file->data[pos])) {
+        pos++;
+    }
+    file->pos = pos;
+
+    if (pos == file->size) {
+        return file->eof ? -1 : 0;
+    }
+
+    switch (file->format) {
+    case FORMAT_LINES:
+        if (!find_line_end(file, pos, &line_end)) {
+            return 0;
+        }
+        *start = pos;
+        *end = trim_line(file, pos, line_end);
+        *next = next_line(file, line_end);
+        return 1;
+
+    case FORMAT_FASTQ:
+        if (file->data[pos] != '@') {
+            bad_input("FASTQ record does not start with '@'");
+        }
+
+        // header, sequence, separator and quality lines
+        if (!find_line_end(file, pos, &line_end)) {
+            return 0;
+        }
+        *start = next_line(file, line_end);
+        if (!find_line_end(file, *start, &line_end)) {
+            return 0;
+        }
+        *end = trim_line(file, *start, line_end);
+        line = next_line(file, line_end);
+        if (!find_line_end(file, line, &line_end)) {
+            return 0;
+        }
+        if (line == file->size || file->data[line] != '+') {
+            bad_input("FASTQ record is missing the '+' line");
+        }
+        line = next_line(file, line_end);
+        if (!find_line_end(file, line, &line_end)) {
+            return 0;
+        }
+        *next = next_line(file, line_end);
+        return 1;
+
+    case FORMAT_FASTA:
+        if (file->data[pos] != '>') {
+            bad_input("FASTA record does not start with '>'");
+        }
+
+        if (!find_line_end(file, pos, &line_end)) {
+            return 0;
+        }
+        *start = next_line(file, line_end);
+
+        // record ends at the next header or at end of input
+        line = *start;
+        while (line < file->size && file->data[line] != '>') {
+            if (!find_line_end(file, line, &line_end)) {
+                return 0;
+            }
+            line = next_line(file, line_end);
+        }
+        if (line == file->size && !file->eof) {
+            return 0;
+        }
+
+        // join sequence lines, the record is complete so nothing after it is overwritten
+        write = *start;
+        for (size_t i = *start; i < line; i++) {
+            if (file->data[i] != '\n' && file->data[i] != '\r') {
+                file->data[write++] = file->data[i];
+            }
+        }
+        *end = write;
+        *next = line;
+        return 1;
+    }
+
+    return -1;
+}
+
+// format is decided by the first character of the input
+static void detect_format(read_file* file) {
+    size_t pos = 0;
+
+    while (true) {
+        while (pos < file->size && isspace((unsigned char)file->data[pos])) {
+            pos++;
+        }
+
+        if (pos < file->size || file->eof) {
+            break;
+        }
+
+        fill_block(file);
+    }
+
+    file->format = FORMAT_LINES;
+    if (pos < file->size && file->data[pos] == '>') {
+        file->format = FORMAT_FASTA;
+    } else if (pos < file->size && file->data[pos] == '@') {
+        file->format = FORMAT_FASTQ;
+    }
+}
+
+// returns NULL if the file cannot be opened
+read_file* open_read_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    unsigned char magic[2];
+    struct stat st;
+    read_file* file;
+    bool gzipped;
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    file = calloc(1, sizeof(read_file));
+
+    // pread fails on pipes which are streamed anyway
+    gzipped = pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+
+    if (!gzipped && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        // private writable mapping lets FASTA records be joined in place without touching the file
+        char* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            file->data = data;
+            file->size = st.st_size;
+            file->eof = true;
+            detect_format(file);
+            return file;
+        }
+    }
+
+    // zlib passes input that is not compressed through unchanged
+    if ((file->stream = gzdopen(fd, "rb")) == NULL) {
+        close(fd);
+        free(file);
+        return NULL;
+    }
+    gzbuffer(file->stream, BLOCK_SIZE);
+
+    file->capacity = BLOCK_SIZE;
+    file->data = malloc(file->capacity);
+    detect_format(file);
+    return file;
+}
+
+void close_read_file(read_file* file) {
+    release_reads(file);
+
+    if (file->stream == NULL) {
+        munmap(file->data, file->size);
+    } else {
+        gzclose(file->stream);
+        free(file->data);
+    }
+
+    free(file);
+}
+
+/**
+ * finds the next read in file
+ * read points into the input and is not null terminated
+ * it stays valid until release_reads is called
+ * returns false when there are no more reads
+ */
+bool next_read(read_file* file, char** read, int* read_len) {
+    size_t start, end, next;
+    int found;
+
+    while ((found = parse_record(file, &start, &end, &next)) == 0) {
+        fill_block(file);
+    }
+
+    if (found < 0) {
+        return false;
+    }
+
+    *read = file->data + start;
+    *read_len = end - start;
+    file->pos = next;
+    return true;
+}
+
+// marks all reads returned so far as no longer used so their input can be reused
+void release_reads(read_file* file) {
+    retired_block* block;
+
+    while ((block = file->retired) != NULL) {
+        file->retired = block->next;
+        free(block->data);
+        free(block);
+    }
+
+    file->kept = file->pos;
+}
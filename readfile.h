@@ -0,0 +1,44 @@
+#ifndef READFILE_H
+#define READFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zlib.h>
+
+// formats of read files, detected from the first record
+typedef enum read_format {
+    FORMAT_LINES,   // one read per line
+    FORMAT_FASTA,   // '>' header followed by one or more sequence lines
+    FORMAT_FASTQ    // '@' header, sequence, '+' separator and quality lines
+} read_format;
+
+// block of streamed input kept alive because reads returned from it are not released yet
+typedef struct retired_block {
+    char* data;
+    struct retired_block* next;
+} retired_block;
+
+// source of reads from a file
+// regular files are memory mapped, gzip files and pipes are streamed in blocks
+// reads are returned as pointers into the mapping or block without copying
+typedef struct read_file {
+    gzFile stream;          // NULL when the file is mapped
+    char* data;             // mapped file or current block
+    size_t size;            // bytes of input in data
+    size_t capacity;        // bytes allocated for the current block
+    size_t pos;             // start of the next record
+    size_t kept;            // start of the first read in data that is not released
+    bool eof;               // no more input after size
+    read_format format;
+    retired_block* retired;
+} read_file;
+
+// read file creation and destruction
+read_file* open_read_file(const char* path);
+void close_read_file(read_file* file);
+
+// read operations
+bool next_read(read_file* file, char** read, int* read_len);
+void release_reads(read_file* file);
+
+#endif
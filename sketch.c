@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include "./sketch.h"
+
+// helper functions
+static uint64_t mix(uint64_t key);
+static void counter_indices(struct CSketch *sketch, const uint64_t *key, size_t *indices);
+static void *cmalloc(size_t size);
+static void *ccalloc(size_t num, size_t size);
+
+// width is rounded down to a power of two so that indices can be masked
+struct CSketch *ccreate_sketch(size_t bytes, int key_words)
+{
+  struct CSketch *sketch;
+
+  sketch = cmalloc(sizeof(struct CSketch));
+
+  sketch->width = 1;
+  while (sketch->width * 2 * SKETCH_ROWS <= bytes) sketch->width *= 2;
+  sketch->key_words = key_words;
+  sketch->counters = ccalloc(sketch->width * SKETCH_ROWS, sizeof(uint8_t));
+
+  return sketch;
+}
+
+void cfree_sketch(struct CSketch *sketch)
+{
+  free(sketch->counters);
+  free(sketch);
+}
+
+// increments the counter of key in every row unless it is saturated
+void csketch_add(struct CSketch *sketch, const uint64_t *key)
+{
+  size_t indices[SKETCH_ROWS];
+  uint8_t *counter, count;
+  int ii;
+
+  counter_indices(sketch, key, indices);
+
+  for (ii = 0; ii < SKETCH_ROWS; ii++) {
+    counter = &sketch->counters[indices[ii]];
+    count = __atomic_load_n(counter, __ATOMIC_RELAXED);
+    while (count < SKETCH_MAX &&
+           !__atomic_compare_exchange_n(counter, &count, count + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+}
+
+// returns the smallest counter of key, SKETCH_MAX if key may have been counted more often
+int csketch_estimate(struct CSketch *sketch, const uint64_t *key)
+{
+  size_t indices[SKETCH_ROWS];
+  int estimate, ii;
+
+  counter_indices(sketch, key, indices);
+
+  estimate = SKETCH_MAX;
+  for (ii = 0; ii < SKETCH_ROWS; ii++) {
+    if (sketch->counters[indices[ii]] < estimate) estimate = sketch->counters[indices[ii]];
+  }
+
+  return estimate;
+}
+
+// murmur3 finalizer, same mixing as fgenerate_hash
+static uint64_t mix(uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+
+  return key;
+}
+
+// index of the counter of key in every row
+// rows use double hashing, the odd step keeps indices of different rows apart
+static void counter_indices(struct CSketch *sketch, const uint64_t *key, size_t *indices)
+{
+  uint64_t hash, step;
+  int ii;
+
+  hash = 0;
+  for (ii = sketch->key_words - 1; ii >= 0; ii--) {
+    hash = mix(hash ^ key[ii]);
+  }
+  step = mix(hash) | 1;
+
+  for (ii = 0; ii < SKETCH_ROWS; ii++) {
+    indices[ii] = ii * sketch->width + ((hash + ii * step) & (sketch->width - 1));
+  }
+}
+
+static void *cmalloc(size_t size)
+{
+  void *ptr;
+
+  ptr = malloc(size);
+
+  if (!ptr) exit(EXIT_FAILURE);
+
+  return ptr;
+}
+
+static void *ccalloc(size_t num, size_t size)
+{
+  void *ptr;
+
+  ptr = calloc(num, size);
+
+  if (!ptr) exit(EXIT_FAILURE);
+
+  return ptr;
+}
@@ -0,0 +1,33 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// count-min sketch of packed kmers
+// every kmer increments one counter in each row, its estimate is the smallest of those counters
+// estimates are never below the true count, collisions can only raise them
+// counters are bytes that saturate at SKETCH_MAX instead of wrapping
+// counting is thread safe, estimates should only be read once counting is done
+
+#define SKETCH_ROWS 4
+#define SKETCH_MAX UINT8_MAX
+
+// struct representing the sketch
+// each row has width counters, width is a power of two
+struct CSketch {
+  size_t width;
+  int key_words;
+  uint8_t *counters;
+};
+
+// sketch creation and destruction, bytes is the memory used by all counters
+struct CSketch *ccreate_sketch(size_t bytes, int key_words);
+void cfree_sketch(struct CSketch *sketch);
+
+// sketch operations
+void csketch_add(struct CSketch *sketch, const uint64_t *key);
+int csketch_estimate(struct CSketch *sketch, const uint64_t *key);
+
+#endif
@@ -0,0 +1,167 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+// kmers start on 8 byte boundaries so their words can be used in place
+#define PADDED(bytes) (((bytes) + 7) & ~(size_t)7)
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+static void write_failure(const char* message) {
+    perror(message);
+    exit(EXIT_FAILURE);
+}
+
+static void bad_snapshot(const char* message) {
+    fprintf(stderr, "malformed snapshot: %s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static void write_bytes(snapshot_writer* writer, const void* bytes, size_t size) {
+    if (size > 0 && fwrite(bytes, size, 1, writer->file) != 1) {
+        write_failure("could not write snapshot");
+    }
+}
+
+// header is written again with the counts once all kmers are written
+snapshot_writer* create_snapshot(const char* path, const snapshot_header* params) {
+    FILE* file = fopen(path, "wb");
+    snapshot_writer* writer;
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    writer = malloc(sizeof(snapshot_writer));
+    writer->file = file;
+    writer->header = *params;
+    memcpy(writer->header.magic, SNAPSHOT_MAGIC, sizeof(writer->header.magic));
+    writer->header.version = SNAPSHOT_VERSION;
+    writer->header.mmer_count = 0;
+    writer->header.kmer_count = 0;
+    write_bytes(writer, &writer->header, sizeof(snapshot_header));
+    return writer;
+}
+
+void write_snapshot_bucket(snapshot_writer* writer, int mmer, int kmer_count) {
+    snapshot_bucket bucket = {mmer, kmer_count};
+
+    write_bytes(writer, &bucket, sizeof(snapshot_bucket));
+    writer->header.mmer_count++;
+}
+
+// list is written without spare capacity, so it must not be appended to once mapped
+void write_snapshot_kmer(snapshot_writer* writer, const uint64_t* key, const read_id_list* read_ids) {
+    static const char padding[8] = {0};
+    read_id_list list = *read_ids;
+    size_t list_bytes = sizeof(read_id_list) + read_ids->size;
+
+    list.capacity = read_ids->size;
+    write_bytes(writer, key, writer->header.key_words * sizeof(uint64_t));
+    write_bytes(writer, &list, sizeof(read_id_list));
+    write_bytes(writer, read_ids->bytes, read_ids->size);
+    write_bytes(writer, padding, PADDED(list_bytes) - list_bytes);
+    writer->header.kmer_count++;
+}
+
+void close_snapshot(snapshot_writer* writer) {
+    if (fseek(writer->file, 0, SEEK_SET) != 0) {
+        write_failure("could not write snapshot");
+    }
+    write_bytes(writer, &writer->header, sizeof(snapshot_header));
+    if (fclose(writer->file) != 0) {
+        write_failure("could not write snapshot");
+    }
+    free(writer);
+}
+
+snapshot* map_snapshot(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    snapshot* snap;
+    void* data;
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(snapshot_header)) {
+        bad_snapshot("file is too short");
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    snap = malloc(sizeof(snapshot));
+    snap->data = data;
+    snap->size = st.st_size;
+    snap->pos = sizeof(snapshot_header);
+    memcpy(&snap->header, data, sizeof(snapshot_header));
+
+    if (memcmp(snap->header.magic, SNAPSHOT_MAGIC, sizeof(snap->header.magic)) != 0) {
+        bad_snapshot("file is not a snapshot");
+    }
+    if (snap->header.version != SNAPSHOT_VERSION) {
+        bad_snapshot("snapshot was written by another version");
+    }
+
+    return snap;
+}
+
+// returns false once all buckets have been read
+bool next_snapshot_bucket(snapshot* snap, int* mmer, int* kmer_count) {
+    const snapshot_bucket* bucket;
+
+    if (snap->pos == snap->size) {
+        return false;
+    }
+    if (snap->size - snap->pos < sizeof(snapshot_bucket)) {
+        bad_snapshot("bucket is cut off");
+    }
+
+    bucket = (const snapshot_bucket*)(snap->data + snap->pos);
+    if (bucket->kmer_count < 0) {
+        bad_snapshot("bucket has a negative number of kmers");
+    }
+    *mmer = bucket->mmer;
+    *kmer_count = bucket->kmer_count;
+    snap->pos += sizeof(snapshot_bucket);
+    return true;
+}
+
+// key and read ids point into the mapping, read ids must not be modified or freed
+void next_snapshot_kmer(snapshot* snap, const uint64_t** key, read_id_list** read_ids) {
+    size_t key_bytes = snap->header.key_words * sizeof(uint64_t);
+    read_id_list* list;
+
+    if (snap->size - snap->pos < key_bytes + sizeof(read_id_list)) {
+        bad_snapshot("kmer is cut off");
+    }
+    list = (read_id_list*)(snap->data + snap->pos + key_bytes);
+    if (list->size < 0 || (size_t)list->size > snap->size - snap->pos - key_bytes - sizeof(read_id_list)) {
+        bad_snapshot("read ids are cut off");
+    }
+
+    *key = (const uint64_t*)(snap->data + snap->pos);
+    *read_ids = list;
+    snap->pos = MIN(snap->size, snap->pos + key_bytes + PADDED(sizeof(read_id_list) + list->size));
+}
+
+void unmap_snapshot(snapshot* snap) {
+    munmap((void*)snap->data, snap->size);
+    free(snap);
+}
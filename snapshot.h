@@ -0,0 +1,64 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "idlist.h"
+
+#define SNAPSHOT_MAGIC "KMERSNAP"
+#define SNAPSHOT_VERSION 1
+
+// file holding pruned kmer tables so that a later run can start at extension
+// the header is followed by one bucket per mmer, each followed by its kmers
+// a kmer is its packed key words followed by its read_id_list, padded to 8 bytes
+// everything is in the byte order of the machine that wrote it
+typedef struct snapshot_header {
+    char magic[8];
+    uint32_t version;
+    int32_t kmer_size;
+    int32_t mmer_size;
+    int32_t key_words;          // words of each packed kmer
+    int32_t random_order;       // 1 if signatures were chosen by random mmer order
+    int32_t abundance_cutoff;   // cutoff the kmers were pruned with
+    uint64_t mmer_count;
+    uint64_t kmer_count;
+} snapshot_header;
+
+// kmer table of one mmer, followed by kmer_count kmers
+typedef struct snapshot_bucket {
+    int32_t mmer;
+    int32_t kmer_count;
+} snapshot_bucket;
+
+// snapshot being written, counts in header are filled in by close_snapshot
+typedef struct snapshot_writer {
+    FILE* file;
+    snapshot_header header;
+} snapshot_writer;
+
+// snapshot mapped read only, read ids of its kmers are used in place
+typedef struct snapshot {
+    const char* data;
+    size_t size;
+    size_t pos;                 // start of the next bucket or kmer
+    snapshot_header header;
+} snapshot;
+
+// writing
+// returns NULL if path cannot be created, other failures end the program
+snapshot_writer* create_snapshot(const char* path, const snapshot_header* params);
+void write_snapshot_bucket(snapshot_writer* writer, int mmer, int kmer_count);
+void write_snapshot_kmer(snapshot_writer* writer, const uint64_t* key, const read_id_list* read_ids);
+void close_snapshot(snapshot_writer* writer);
+
+// reading
+// returns NULL if path cannot be opened, a file that is not a valid snapshot ends the program
+snapshot* map_snapshot(const char* path);
+bool next_snapshot_bucket(snapshot* snap, int* mmer, int* kmer_count);
+void next_snapshot_kmer(snapshot* snap, const uint64_t** key, read_id_list** read_ids);
+void unmap_snapshot(snapshot* snap);
+
+#endif
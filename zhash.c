@@ -1,14 +1,20 @@
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "./zhash.h"
 
 // helper functions
 static size_t next_size_index(size_t size_index);
 static size_t previous_size_index(size_t size_index);
-static struct ZHashTable *zcreate_hash_table_with_size(size_t size_index);
+static struct ZHashTable *zcreate_hash_table_with_size(size_t size_index, bool packed);
+static size_t zgenerate_entry_hash(struct ZHashTable *hash_table, struct ZHashEntry *entry);
+static size_t ztable_size(struct ZHashTable *hash_table);
 static void *zmalloc(size_t size);
 static void *zcalloc(size_t num, size_t size);
 
+// arena for entries and keys of string tables, NULL uses malloc
+static struct ZArena *entry_arena = NULL;
+
 // possible sizes for hash table; must be prime numbers
 static const size_t hash_sizes[] = {
   53, 101, 211, 503, 1553, 3407, 6803, 12503, 25013, 50261,
@@ -18,17 +24,41 @@ static const size_t hash_sizes[] = {
 
 struct ZHashTable *zcreate_hash_table(void)
 {
-  return zcreate_hash_table_with_size(0);
+  return zcreate_hash_table_with_size(0, false);
+}
+
+struct ZHashTable *zcreate_packed_hash_table(void)
+{
+  return zcreate_hash_table_with_size(0, true);
+}
+
+// packed table with a slot for each key below key_count, so the key is its own hash
+// the table never grows or shrinks and is iterated in increasing order of keys
+struct ZHashTable *zcreate_direct_hash_table(size_t key_count)
+{
+  struct ZHashTable *hash_table;
+
+  hash_table = zmalloc(sizeof(struct ZHashTable));
+
+  hash_table->size_index = 0;
+  hash_table->direct_size = key_count;
+  hash_table->entry_count = 0;
+  hash_table->packed = true;
+  hash_table->entries = zcalloc(key_count, sizeof(void *));
+
+  return hash_table;
 }
 
-static struct ZHashTable *zcreate_hash_table_with_size(size_t size_index)
+static struct ZHashTable *zcreate_hash_table_with_size(size_t size_index, bool packed)
 {
   struct ZHashTable *hash_table;
 
   hash_table = zmalloc(sizeof(struct ZHashTable));
 
   hash_table->size_index = size_index;
+  hash_table->direct_size = 0;
   hash_table->entry_count = 0;
+  hash_table->packed = packed;
   hash_table->entries = zcalloc(hash_sizes[size_index], sizeof(void *));
 
   return hash_table;
@@ -38,12 +68,15 @@ void zfree_hash_table(struct ZHashTable *hash_table)
 {
   size_t size, ii;
 
-  size = hash_sizes[hash_table->size_index];
+  size = ztable_size(hash_table);
 
   for (ii = 0; ii < size; ii++) {
     struct ZHashEntry *entry;
 
-    if ((entry = hash_table->entries[ii])) zfree_entry(entry, true);
+    if (!(entry = hash_table->entries[ii])) continue;
+
+    if (hash_table->packed) zfree_packed_entry(entry, true);
+    else zfree_entry(entry, true);
   }
 
   zfree(hash_table->entries);
@@ -72,7 +105,7 @@ void zhash_set(struct ZHashTable *hash_table, char *key, void *val)
   hash_table->entries[hash] = entry;
   hash_table->entry_count++;
 
-  size = hash_sizes[hash_table->size_index];
+  size = ztable_size(hash_table);
 
   if (hash_table->entry_count > size / 2) {
     zhash_rehash(hash_table, next_size_index(hash_table->size_index));
@@ -92,6 +125,19 @@ void *zhash_get(struct ZHashTable *hash_table, char *key)
   return entry ? entry->val : NULL;
 }
 
+// returns pointer to the pointer of the entry holding key, NULL if key is absent
+// hash is zgenerate_hash of key, passed in so that callers that already computed it do not hash again
+struct ZHashEntry **zhash_find_entry(struct ZHashTable *hash_table, size_t hash, char *key)
+{
+  struct ZHashEntry **entry;
+
+  entry = &hash_table->entries[hash];
+
+  while (*entry && strcmp(key, (*entry)->key) != 0) entry = &(*entry)->next;
+
+  return *entry ? entry : NULL;
+}
+
 void *zhash_delete(struct ZHashTable *hash_table, char *key)
 {
   size_t size, hash;
@@ -123,7 +169,7 @@ void *zhash_delete(struct ZHashTable *hash_table, char *key)
   zfree_entry(entry, false);
   hash_table->entry_count--;
 
-  size = hash_sizes[hash_table->size_index];
+  size = ztable_size(hash_table);
 
   if (hash_table->entry_count < size / 8) {
     zhash_rehash(hash_table, previous_size_index(hash_table->size_index));
@@ -145,16 +191,106 @@ bool zhash_exists(struct ZHashTable *hash_table, char *key)
   return entry ? true : false;
 }
 
+void zhash_set_packed(struct ZHashTable *hash_table, uint64_t key, void *val)
+{
+  size_t size, hash;
+  struct ZHashEntry *entry;
+
+  hash = zgenerate_packed_hash(hash_table, key);
+  entry = hash_table->entries[hash];
+
+  while (entry) {
+    if (entry->packed_key == key) {
+      entry->val = val;
+      return;
+    }
+    entry = entry->next;
+  }
+
+  entry = zcreate_packed_entry(key, val, hash_table->entries[hash]);
+  hash_table->entries[hash] = entry;
+  hash_table->entry_count++;
+
+  size = ztable_size(hash_table);
+
+  if (hash_table->entry_count > size / 2) {
+    zhash_rehash(hash_table, next_size_index(hash_table->size_index));
+  }
+}
+
+void *zhash_get_packed(struct ZHashTable *hash_table, uint64_t key)
+{
+  size_t hash;
+  struct ZHashEntry *entry;
+
+  hash = zgenerate_packed_hash(hash_table, key);
+  entry = hash_table->entries[hash];
+
+  while (entry && entry->packed_key != key) entry = entry->next;
+
+  return entry ? entry->val : NULL;
+}
+
+void zhash_iterate_init(struct ZHashIterator *iterator, struct ZHashTable *hash_table)
+{
+  iterator->table = hash_table;
+  iterator->index = 0;
+  iterator->entry = NULL;
+  iterator->remove = false;
+}
+
+// returns pointer to the pointer of the next entry, NULL when all entries have been returned
+// an entry marked for removal is freed here, the pointer to it then refers to the next entry
+struct ZHashEntry **zhash_iterate(struct ZHashIterator *iterator)
+{
+  struct ZHashTable *hash_table;
+  struct ZHashEntry *entry;
+  size_t size;
+
+  hash_table = iterator->table;
+  size = ztable_size(hash_table);
+
+  if (iterator->entry && *iterator->entry) {
+    if (iterator->remove) {
+      entry = *iterator->entry;
+      *iterator->entry = entry->next;
+      if (hash_table->packed) zfree_packed_entry(entry, false);
+      else zfree_entry(entry, false);
+      hash_table->entry_count--;
+      iterator->remove = false;
+    } else {
+      iterator->entry = &(*iterator->entry)->next;
+    }
+  }
+
+  // move to the next non empty chain
+  while (!iterator->entry || !*iterator->entry) {
+    if (iterator->index == size) return NULL;
+    iterator->entry = &hash_table->entries[iterator->index++];
+  }
+
+  return iterator->entry;
+}
+
+// marks the entry last returned by zhash_iterate for removal
+// it is removed by the next call to zhash_iterate
+void zhash_iterate_remove(struct ZHashIterator *iterator)
+{
+  iterator->remove = true;
+}
+
 struct ZHashEntry *zcreate_entry(char *key, void *val)
 {
   struct ZHashEntry *entry;
   char *key_cpy;
+  size_t key_len = strlen(key);
 
-  key_cpy = zmalloc((strlen(key) + 1) * sizeof(char));
-  entry = zmalloc(sizeof(struct ZHashEntry));
+  key_cpy = zarena_alloc(entry_arena, (key_len + 1) * sizeof(char));
+  entry = zarena_alloc(entry_arena, sizeof(struct ZHashEntry));
 
-  strcpy(key_cpy, key);
+  memcpy(key_cpy, key, key_len + 1);
   entry->key = key_cpy;
+  entry->key_len = key_len;
   entry->val = val;
 
   return entry;
@@ -164,16 +300,42 @@ void zfree_entry(struct ZHashEntry *entry, bool recursive)
 {
   if (recursive && entry->next) zfree_entry(entry->next, recursive);
 
-  zfree(entry->key);
+  zarena_free(entry_arena, entry->key, (entry->key_len + 1) * sizeof(char));
+  zarena_free(entry_arena, entry, sizeof(struct ZHashEntry));
+}
+
+// packed entries end before key_len, so they are filled in whole, already linked to next, and copied
+struct ZHashEntry *zcreate_packed_entry(uint64_t key, void *val, struct ZHashEntry *next)
+{
+  struct ZHashEntry filled = { .packed_key = key, .val = val, .next = next };
+  struct ZHashEntry *entry;
+
+  entry = zmalloc(offsetof(struct ZHashEntry, key_len));
+  memcpy(entry, &filled, offsetof(struct ZHashEntry, key_len));
+
+  return entry;
+}
+
+void zfree_packed_entry(struct ZHashEntry *entry, bool recursive)
+{
+  if (recursive && entry->next) zfree_packed_entry(entry->next, recursive);
+
   zfree(entry);
 }
 
+// entries of string tables must be created and freed with the same arena set
+// set it before creating the first string table and keep it until they are all freed
+void zhash_set_arena(struct ZArena *arena)
+{
+  entry_arena = arena;
+}
+
 size_t zgenerate_hash(struct ZHashTable *hash_table, char *key)
 {
   size_t size, hash;
   char ch;
 
-  size = hash_sizes[hash_table->size_index];
+  size = ztable_size(hash_table);
   hash = 0;
 
   while ((ch = *key++)) hash = (17 * hash + ch) % size;
@@ -181,14 +343,36 @@ size_t zgenerate_hash(struct ZHashTable *hash_table, char *key)
   return hash;
 }
 
+// mixes all bits of the packed key (murmur3 finalizer) so neighbouring kmers spread out
+// keys of direct tables are not mixed as they index the slots
+size_t zgenerate_packed_hash(struct ZHashTable *hash_table, uint64_t key)
+{
+  if (hash_table->direct_size) return key;
+
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+
+  return key % hash_sizes[hash_table->size_index];
+}
+
+static size_t zgenerate_entry_hash(struct ZHashTable *hash_table, struct ZHashEntry *entry)
+{
+  if (hash_table->packed) return zgenerate_packed_hash(hash_table, entry->packed_key);
+
+  return zgenerate_hash(hash_table, entry->key);
+}
+
 void zhash_rehash(struct ZHashTable *hash_table, size_t size_index)
 {
   size_t hash, size, ii;
   struct ZHashEntry **entries;
 
-  if (size_index == hash_table->size_index) return;
+  if (size_index == hash_table->size_index || hash_table->direct_size) return;
 
-  size = hash_sizes[hash_table->size_index];
+  size = ztable_size(hash_table);
   entries = hash_table->entries;
 
   hash_table->size_index = size_index;
@@ -201,7 +385,7 @@ void zhash_rehash(struct ZHashTable *hash_table, size_t size_index)
     while (entry) {
       struct ZHashEntry *next_entry;
 
-      hash = zgenerate_hash(hash_table, entry->key);
+      hash = zgenerate_entry_hash(hash_table, entry);
       next_entry = entry->next;
       entry->next = hash_table->entries[hash];
       hash_table->entries[hash] = entry;
@@ -213,6 +397,13 @@ void zhash_rehash(struct ZHashTable *hash_table, size_t size_index)
   zfree(entries);
 }
 
+static size_t ztable_size(struct ZHashTable *hash_table)
+{
+  if (hash_table->direct_size) return hash_table->direct_size;
+
+  return hash_sizes[hash_table->size_index];
+}
+
 static size_t next_size_index(size_t size_index)
 {
   if (size_index == COUNT_OF(hash_sizes)) return size_index;
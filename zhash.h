@@ -2,31 +2,56 @@
 #define ZHASH_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "./arena.h"
 
 // hash table
-// keys are strings
+// keys are strings, or 2-bit packed kmers in tables created by zcreate_packed_hash_table
 // values are void *pointers
+// entries and keys of string tables come from the arena set by zhash_set_arena, if any
 
 #define COUNT_OF(arr) (sizeof(arr) / sizeof(*arr))
 #define zfree free
 
 // struct representing an entry in the hash table
+// packed keys are stored inline and need no allocation of their own
+// key_len is the length of a string key so that it is not counted again
+// it comes last so that packed entries are allocated without it
 struct ZHashEntry {
-  char *key;
+  union {
+    char *key;
+    uint64_t packed_key;
+  };
   void *val;
   struct ZHashEntry *next;
+  size_t key_len;
 };
 
 // struct representing the hash table
 // size_index is an index into the hash_sizes array in hash.c
+// direct_size is the number of slots of a direct table and 0 for tables that are hashed
+// packed is true when the entries use packed_key instead of key
 struct ZHashTable {
   size_t size_index;
+  size_t direct_size;
   size_t entry_count;
+  bool packed;
   struct ZHashEntry **entries;
 };
 
+// cursor for iterating a table, owned by the caller so iterations can be nested
+// entry is a pointer to the pointer of the current entry which allows deleting it safely
+struct ZHashIterator {
+  struct ZHashTable *table;
+  size_t index;
+  struct ZHashEntry **entry;
+  bool remove;
+};
+
 // hash table creation and destruction
 struct ZHashTable *zcreate_hash_table(void);
+struct ZHashTable *zcreate_packed_hash_table(void);
+struct ZHashTable *zcreate_direct_hash_table(size_t key_count);
 void zfree_hash_table(struct ZHashTable *hash_table);
 
 // hash operations
@@ -34,13 +59,27 @@ void zhash_set(struct ZHashTable *hash_table, char *key, void *val);
 void *zhash_get(struct ZHashTable *hash_table, char *key);
 void *zhash_delete(struct ZHashTable *hash_table, char *key);
 bool zhash_exists(struct ZHashTable *hash_table, char *key);
+struct ZHashEntry **zhash_find_entry(struct ZHashTable *hash_table, size_t hash, char *key);
+
+// packed hash operations
+void zhash_set_packed(struct ZHashTable *hash_table, uint64_t key, void *val);
+void *zhash_get_packed(struct ZHashTable *hash_table, uint64_t key);
+
+// iteration
+void zhash_iterate_init(struct ZHashIterator *iterator, struct ZHashTable *hash_table);
+struct ZHashEntry **zhash_iterate(struct ZHashIterator *iterator);
+void zhash_iterate_remove(struct ZHashIterator *iterator);
 
 // hash entry creation and destruction
 struct ZHashEntry *zcreate_entry(char *key, void *val);
 void zfree_entry(struct ZHashEntry *entry, bool recursive);
+struct ZHashEntry *zcreate_packed_entry(uint64_t key, void *val, struct ZHashEntry *next);
+void zfree_packed_entry(struct ZHashEntry *entry, bool recursive);
 
 // other functions
+void zhash_set_arena(struct ZArena *arena);
 size_t zgenerate_hash(struct ZHashTable *hash, char *key);
+size_t zgenerate_packed_hash(struct ZHashTable *hash, uint64_t key);
 void zhash_rehash(struct ZHashTable *hash_table, size_t size_index);
 
 #endif